@@ -0,0 +1,328 @@
+
+#include <cstring>
+
+#include "base64.h"
+#include "simd.h"
+
+namespace Pt
+{
+
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+struct BASE64_DECODE_TABLE
+{
+    uint8_t value[256];
+
+    constexpr BASE64_DECODE_TABLE() : value()
+    {
+        for (int i = 0; i < 256; i++)
+            value[i] = 0xff;
+        for (int i = 0; i < 64; i++)
+            value[(uint8_t)base64_chars[i]] = (uint8_t)i;
+    }
+};
+
+static constexpr BASE64_DECODE_TABLE base64_table;
+
+#if defined(PTK_SIMD_X86)
+
+// 编码和解码的 SIMD 实现参考 Wojciech Muła 和 Daniel Lemire 的方法
+// 每 12 字节输入对应 16 个字符输出, 一个 128 位通道一组
+
+// 每个 32 位里放 3 个字节, 拆成 4 个 6 位的索引
+PTK_TARGET_SSSE3
+static inline __m128i enc_reshuffle(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+// 索引 -> 字符, 按区间查偏移量
+PTK_TARGET_SSSE3
+static inline __m128i enc_translate(__m128i indices)
+{
+    const __m128i shift_lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, //
+                                            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, //
+                                            '/' - 63, 'A', 0, 0);
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    result = _mm_shuffle_epi8(shift_lut, result);
+    return _mm_add_epi8(result, indices);
+}
+
+PTK_TARGET_AVX2
+static inline __m256i enc_reshuffle(__m256i in)
+{
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1, //
+                                                 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+}
+
+PTK_TARGET_AVX2
+static inline __m256i enc_translate(__m256i indices)
+{
+    const __m256i shift_lut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, //
+                                               '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, //
+                                               '/' - 63, 'A', 0, 0,                                        //
+                                               'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, //
+                                               '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, //
+                                               '/' - 63, 'A', 0, 0);
+    __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    result = _mm256_shuffle_epi8(shift_lut, result);
+    return _mm256_add_epi8(result, indices);
+}
+
+// 返回已经处理的输入字节数 (3 的倍数)
+PTK_TARGET_SSSE3
+static size_t encode_ssse3(const uint8_t *src, size_t size, char *dst, uint8_t key)
+{
+    const __m128i k = _mm_set1_epi8((char)key);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 12, dst += 16) // 每次读 16 字节, 用前 12 字节
+    {
+        __m128i in = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), k);
+        _mm_storeu_si128((__m128i *)dst, enc_translate(enc_reshuffle(in)));
+    }
+    return i;
+}
+
+PTK_TARGET_AVX2
+static size_t encode_avx2(const uint8_t *src, size_t size, char *dst, uint8_t key)
+{
+    const __m256i k = _mm256_set1_epi8((char)key);
+    size_t i = 0;
+    for (; i + 28 <= size; i += 24, dst += 32) // 两个通道各读 16 字节, 各用前 12 字节
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + i + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        in = _mm256_xor_si256(in, k);
+        _mm256_storeu_si256((__m256i *)dst, enc_translate(enc_reshuffle(in)));
+    }
+    return i + encode_ssse3(src + i, size - i, dst, key);
+}
+
+// 字符在 [lo, hi] 之间的位置为 0xff, 非 ASCII 字符是负数, 不会落在区间里
+PTK_TARGET_SSSE3
+static inline __m128i in_range(__m128i in, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8(lo - 1)), //
+                         _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), in));
+}
+
+PTK_TARGET_AVX2
+static inline __m256i in_range(__m256i in, char lo, char hi)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8(lo - 1)), //
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), in));
+}
+
+// 字符 -> 6 位的值, 有非法字符时 valid 不全为 1
+PTK_TARGET_SSSE3
+static inline __m128i dec_translate(__m128i in, __m128i &valid)
+{
+    const __m128i upper = in_range(in, 'A', 'Z');
+    const __m128i lower = in_range(in, 'a', 'z');
+    const __m128i digit = in_range(in, '0', '9');
+    const __m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+    const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+
+    valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+
+    __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+    shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+    return _mm_add_epi8(in, shift);
+}
+
+// 4 个 6 位的值合并成 3 个字节, 每个通道的前 12 字节有效
+PTK_TARGET_SSSE3
+static inline __m128i dec_pack(__m128i values)
+{
+    const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+PTK_TARGET_AVX2
+static inline __m256i dec_translate(__m256i in, __m256i &valid)
+{
+    const __m256i upper = in_range(in, 'A', 'Z');
+    const __m256i lower = in_range(in, 'a', 'z');
+    const __m256i digit = in_range(in, '0', '9');
+    const __m256i plus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+    const __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+
+    valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(_mm256_or_si256(digit, plus), slash));
+
+    __m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/')));
+    return _mm256_add_epi8(in, shift);
+}
+
+PTK_TARGET_AVX2
+static inline __m256i dec_pack(__m256i values)
+{
+    const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    const __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    return _mm256_shuffle_epi8(packed, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, //
+                                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+// 只处理不含填充的完整块, 返回已经处理的字符数 (4 的倍数), 遇到非法字符时提前停下交给标量处理
+PTK_TARGET_SSSE3
+static size_t decode_ssse3(const char *src, size_t len, uint8_t *dst, uint8_t key)
+{
+    const __m128i k = _mm_set1_epi8((char)key);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16, dst += 12)
+    {
+        __m128i valid;
+        __m128i values = dec_translate(_mm_loadu_si128((const __m128i *)(src + i)), valid);
+        if (_mm_movemask_epi8(valid) != 0xffff)
+            break;
+        alignas(16) uint8_t out[16];
+        _mm_store_si128((__m128i *)out, _mm_xor_si128(dec_pack(values), k));
+        memcpy(dst, out, 12);
+    }
+    return i;
+}
+
+PTK_TARGET_AVX2
+static size_t decode_avx2(const char *src, size_t len, uint8_t *dst, uint8_t key)
+{
+    const __m256i k = _mm256_set1_epi8((char)key);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32, dst += 24)
+    {
+        __m256i valid;
+        __m256i values = dec_translate(_mm256_loadu_si256((const __m256i *)(src + i)), valid);
+        if (_mm256_movemask_epi8(valid) != -1)
+            break;
+        alignas(32) uint8_t out[32];
+        _mm256_store_si256((__m256i *)out, _mm256_xor_si256(dec_pack(values), k));
+        memcpy(dst, out, 12);
+        memcpy(dst + 12, out + 16, 12);
+    }
+    return i + decode_ssse3(src + i, len - i, dst, key);
+}
+
+#endif
+
+std::string Base64Encode(const void *data, size_t size, uint8_t key)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    std::string result((size + 2) / 3 * 4, '\0');
+    char *dst = result.data();
+
+    size_t i = 0;
+#if defined(PTK_SIMD_X86)
+    if (CpuHasAVX2())
+        i = encode_avx2(src, size, dst, key);
+    else if (CpuHasSSSE3())
+        i = encode_ssse3(src, size, dst, key);
+    dst += i / 3 * 4;
+#endif
+
+    for (; i + 3 <= size; i += 3, dst += 4)
+    {
+        uint32_t v = ((src[i] ^ key) << 16) | ((src[i + 1] ^ key) << 8) | (src[i + 2] ^ key);
+        dst[0] = base64_chars[(v >> 18) & 0x3f];
+        dst[1] = base64_chars[(v >> 12) & 0x3f];
+        dst[2] = base64_chars[(v >> 6) & 0x3f];
+        dst[3] = base64_chars[v & 0x3f];
+    }
+
+    if (i < size)
+    {
+        uint32_t v = (src[i] ^ key) << 16;
+        if (i + 1 < size)
+            v |= (src[i + 1] ^ key) << 8;
+        dst[0] = base64_chars[(v >> 18) & 0x3f];
+        dst[1] = base64_chars[(v >> 12) & 0x3f];
+        dst[2] = (i + 1 < size) ? base64_chars[(v >> 6) & 0x3f] : '=';
+        dst[3] = '=';
+    }
+
+    return result;
+}
+
+bool Base64Decode(std::string_view str, void *buffer, size_t &size, uint8_t key)
+{
+    size_t len = str.size();
+    if (len % 4 != 0)
+        return false;
+
+    size_t padding = 0;
+    if (len > 0 && str[len - 1] == '=')
+        padding++;
+    if (len > 1 && str[len - 2] == '=')
+        padding++;
+
+    size_t out_size = len / 4 * 3 - padding;
+    if (out_size > size)
+        return false;
+
+    const char *src = str.data();
+    uint8_t *dst = (uint8_t *)buffer;
+
+    // 最后一组可能带填充, 留给标量处理
+    size_t body = (padding > 0) ? len - 4 : len;
+
+    size_t i = 0;
+#if defined(PTK_SIMD_X86)
+    if (CpuHasAVX2())
+        i = decode_avx2(src, body, dst, key);
+    else if (CpuHasSSSE3())
+        i = decode_ssse3(src, body, dst, key);
+    dst += i / 4 * 3;
+#endif
+
+    for (; i < body; i += 4, dst += 3)
+    {
+        uint8_t a = base64_table.value[(uint8_t)src[i]];
+        uint8_t b = base64_table.value[(uint8_t)src[i + 1]];
+        uint8_t c = base64_table.value[(uint8_t)src[i + 2]];
+        uint8_t d = base64_table.value[(uint8_t)src[i + 3]];
+        if ((a | b | c | d) == 0xff)
+            return false;
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        dst[0] = (uint8_t)(v >> 16) ^ key;
+        dst[1] = (uint8_t)(v >> 8) ^ key;
+        dst[2] = (uint8_t)v ^ key;
+    }
+
+    if (padding > 0)
+    {
+        uint8_t a = base64_table.value[(uint8_t)src[i]];
+        uint8_t b = base64_table.value[(uint8_t)src[i + 1]];
+        uint8_t c = (padding == 1) ? base64_table.value[(uint8_t)src[i + 2]] : 0;
+        if ((a | b | c) == 0xff)
+            return false;
+        uint32_t v = (a << 18) | (b << 12) | (c << 6);
+        dst[0] = (uint8_t)(v >> 16) ^ key;
+        if (padding == 1)
+            dst[1] = (uint8_t)(v >> 8) ^ key;
+    }
+
+    size = out_size;
+    return true;
+}
+
+} // namespace Pt
@@ -0,0 +1,21 @@
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace Pt
+{
+
+// Base64 编解码 (标准字母表, 带 = 填充, 不换行)
+// key 不为零时, 编码前/解码后每个字节都和 key 异或, 阵型代码用的是 0x54
+
+std::string Base64Encode(const void *data, size_t size, uint8_t key = 0);
+
+// size 传入缓冲区大小, 传出解码后的字节数
+// 含有非法字符, 长度不是 4 的倍数, 填充位置不对或者缓冲区不够时返回 false
+bool Base64Decode(std::string_view str, void *buffer, size_t &size, uint8_t key = 0);
+
+} // namespace Pt
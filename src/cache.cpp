@@ -0,0 +1,233 @@
+
+#include <fstream>
+#include <system_error>
+
+#include "cache.h"
+
+namespace Pt
+{
+
+static_assert(sizeof(LINEUP_CACHE_HEADER) == 40);
+static_assert(sizeof(LINEUP_CACHE_ITEM) == 128);
+static_assert(sizeof(LINEUP_CACHE_ERROR) == 12);
+
+LineupCache::LineupCache()
+{
+    header = nullptr;
+    items = nullptr;
+    errors = nullptr;
+    strings = nullptr;
+}
+
+LineupCache::~LineupCache()
+{
+    Close();
+}
+
+std::filesystem::path LineupCache::cache_path(const std::filesystem::path &source)
+{
+    std::filesystem::path path = source;
+    path += ".cache";
+    return path;
+}
+
+bool LineupCache::source_key(const std::filesystem::path &source, LINEUP_CACHE_HEADER &key)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(source, ec);
+    if (ec)
+        return false;
+    auto mtime = std::filesystem::last_write_time(source, ec);
+    if (ec)
+        return false;
+    auto path = std::filesystem::absolute(source, ec);
+    if (ec)
+        return false;
+
+    std::u8string u8path = path.generic_u8string();
+    key.source_size = size;
+    key.source_mtime = mtime.time_since_epoch().count();
+    key.path_hash = crc32(0, (const Bytef *)u8path.data(), (uInt)u8path.size());
+    return true;
+}
+
+bool LineupCache::Load(const std::filesystem::path &source)
+{
+    Close();
+
+    LINEUP_CACHE_HEADER key;
+    if (!source_key(source, key))
+        return false;
+
+    if (!file.Open(cache_path(source)) || file.Size() < sizeof(LINEUP_CACHE_HEADER))
+    {
+        Close();
+        return false;
+    }
+
+    const uint8_t *data = file.Data();
+    const LINEUP_CACHE_HEADER *h = (const LINEUP_CACHE_HEADER *)data;
+    if (h->magic != LINEUP_CACHE_MAGIC || h->version != LINEUP_CACHE_VERSION //
+        || h->source_size != key.source_size                                 //
+        || h->source_mtime != key.source_mtime                               //
+        || h->path_hash != key.path_hash)
+    {
+        Close();
+        return false;
+    }
+
+    uint64_t expected = sizeof(LINEUP_CACHE_HEADER)                              //
+                        + uint64_t(h->item_count) * sizeof(LINEUP_CACHE_ITEM)   //
+                        + uint64_t(h->error_count) * sizeof(LINEUP_CACHE_ERROR) //
+                        + h->strings_size;
+    if (expected != file.Size())
+    {
+        Close();
+        return false;
+    }
+
+    const LINEUP_CACHE_ITEM *it = (const LINEUP_CACHE_ITEM *)(data + sizeof(LINEUP_CACHE_HEADER));
+    const LINEUP_CACHE_ERROR *er = (const LINEUP_CACHE_ERROR *)(it + h->item_count);
+    const char *str = (const char *)(er + h->error_count);
+
+    // 检查字符串范围, 之后读取时不再检查
+    for (size_t i = 0; i < h->item_count; i++)
+    {
+        if (uint64_t(it[i].name_offset) + it[i].name_size > h->strings_size //
+            || uint64_t(it[i].code_offset) + it[i].code_size > h->strings_size)
+        {
+            Close();
+            return false;
+        }
+    }
+    for (size_t i = 0; i < h->error_count; i++)
+    {
+        if (uint64_t(er[i].text_offset) + er[i].text_size > h->strings_size)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    header = h;
+    items = it;
+    errors = er;
+    strings = str;
+    return true;
+}
+
+void LineupCache::Close()
+{
+    file.Close();
+    header = nullptr;
+    items = nullptr;
+    errors = nullptr;
+    strings = nullptr;
+}
+
+size_t LineupCache::Count() const
+{
+    return header ? header->item_count : 0;
+}
+
+LineupData LineupCache::Data(size_t i) const
+{
+    LineupData data;
+    memcpy(data.items, items[i].items, sizeof(data.items));
+    data.scene = items[i].scene;
+    data.rake_row = items[i].rake_row;
+    return data;
+}
+
+std::string_view LineupCache::Name(size_t i) const
+{
+    return std::string_view(strings + items[i].name_offset, items[i].name_size);
+}
+
+std::string_view LineupCache::Code(size_t i) const
+{
+    return std::string_view(strings + items[i].code_offset, items[i].code_size);
+}
+
+size_t LineupCache::ErrorCount() const
+{
+    return header ? header->error_count : 0;
+}
+
+std::tuple<int, std::string_view> LineupCache::Error(size_t i) const
+{
+    return {(int)errors[i].line, std::string_view(strings + errors[i].text_offset, errors[i].text_size)};
+}
+
+bool LineupCache::Save(const std::filesystem::path &source,                    //
+                       const std::vector<Lineup> &lineups,                     //
+                       const std::vector<std::tuple<int, std::string>> &errs) //
+{
+    LINEUP_CACHE_HEADER h;
+    memset(&h, 0, sizeof(h));
+    if (!source_key(source, h))
+        return false;
+    h.magic = LINEUP_CACHE_MAGIC;
+    h.version = LINEUP_CACHE_VERSION;
+    h.item_count = (uint32_t)lineups.size();
+    h.error_count = (uint32_t)errs.size();
+
+    std::string pool;
+    auto add_string = [&](const std::string &s, uint32_t &offset, uint32_t &size)
+    {
+        offset = (uint32_t)pool.size();
+        size = (uint32_t)s.size();
+        pool += s;
+    };
+
+    std::vector<LINEUP_CACHE_ITEM> item_list(lineups.size());
+    for (size_t i = 0; i < lineups.size(); i++)
+    {
+        memset(&item_list[i], 0, sizeof(LINEUP_CACHE_ITEM));
+        memcpy(item_list[i].items, lineups[i].items, sizeof(item_list[i].items));
+        item_list[i].scene = lineups[i].scene;
+        item_list[i].rake_row = lineups[i].rake_row;
+        add_string(lineups[i].lineup_name, item_list[i].name_offset, item_list[i].name_size);
+        add_string(lineups[i].lineup_code, item_list[i].code_offset, item_list[i].code_size);
+    }
+
+    std::vector<LINEUP_CACHE_ERROR> error_list(errs.size());
+    for (size_t i = 0; i < errs.size(); i++)
+    {
+        auto &[line, text] = errs[i];
+        error_list[i].line = line;
+        add_string(text, error_list[i].text_offset, error_list[i].text_size);
+    }
+    h.strings_size = (uint32_t)pool.size();
+
+    // 先写临时文件再替换, 中途失败不会留下半个缓存
+    std::filesystem::path path = cache_path(source);
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    bool written = false;
+    {
+        std::ofstream ofs(temp, std::ios::binary | std::ios::trunc);
+        if (ofs)
+        {
+            ofs.write((const char *)&h, sizeof(h));
+            ofs.write((const char *)item_list.data(), item_list.size() * sizeof(LINEUP_CACHE_ITEM));
+            ofs.write((const char *)error_list.data(), error_list.size() * sizeof(LINEUP_CACHE_ERROR));
+            ofs.write(pool.data(), pool.size());
+            ofs.close(); // 关闭时才真正写盘, 要检查关闭的结果
+            written = !ofs.fail();
+        }
+    }
+
+    std::error_code ec;
+    if (written)
+        std::filesystem::rename(temp, path, ec);
+    if (!written || ec)
+    {
+        // 任何一步失败都不在词库旁边留下临时文件
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+} // namespace Pt
@@ -0,0 +1,88 @@
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <filesystem>
+
+#include "lineup.h"
+#include "mapfile.h"
+
+namespace Pt
+{
+
+// 阵型列表缓存文件, 和 yml 文件放在一起, 文件名后面加 .cache
+// 头部 | 阵型[item_count] | 错误行[error_count] | 字符串
+// 用 yml 的路径, 大小和修改时间判断是否过期
+
+#define LINEUP_CACHE_MAGIC 0x434c5450 // "PTLC"
+#define LINEUP_CACHE_VERSION 1
+
+struct LINEUP_CACHE_HEADER
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_size;  // yml 文件大小
+    int64_t source_mtime;  // yml 修改时间
+    uint32_t path_hash;    // yml 绝对路径的 crc32
+    uint32_t item_count;   //
+    uint32_t error_count;  //
+    uint32_t strings_size; //
+};
+
+struct LINEUP_CACHE_ITEM
+{
+    uint16_t items[GRID];
+    uint8_t scene;
+    uint8_t rake_row;
+    uint32_t name_offset;
+    uint32_t name_size;
+    uint32_t code_offset;
+    uint32_t code_size;
+};
+
+struct LINEUP_CACHE_ERROR
+{
+    uint32_t line;
+    uint32_t text_offset;
+    uint32_t text_size;
+};
+
+class LineupCache
+{
+  public:
+    LineupCache();
+    ~LineupCache();
+
+    // 映射 yml 对应的缓存文件, 不存在, 损坏或者过期时返回 false
+    bool Load(const std::filesystem::path &);
+    void Close();
+
+    size_t Count() const;
+    LineupData Data(size_t) const;
+    std::string_view Name(size_t) const;
+    std::string_view Code(size_t) const;
+
+    size_t ErrorCount() const;
+    std::tuple<int, std::string_view> Error(size_t) const; // 行号 原文
+
+    // 解码完成后写入缓存 (阵型按文件中的顺序, 不去重)
+    static bool Save(const std::filesystem::path &,                       //
+                     const std::vector<Lineup> &,                         //
+                     const std::vector<std::tuple<int, std::string>> &); //
+
+  private:
+    MappedFile file;
+    const LINEUP_CACHE_HEADER *header;
+    const LINEUP_CACHE_ITEM *items;
+    const LINEUP_CACHE_ERROR *errors;
+    const char *strings;
+
+    static std::filesystem::path cache_path(const std::filesystem::path &);
+    static bool source_key(const std::filesystem::path &, LINEUP_CACHE_HEADER &);
+};
+
+} // namespace Pt
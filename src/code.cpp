@@ -10,6 +10,8 @@ Code::Code()
     code = new unsigned char[4096 * page];
     length = 0;
     calls_pos.clear();
+    remote = nullptr;
+    remote_size = 0;
 }
 
 Code::~Code()
@@ -111,10 +113,17 @@ void Code::asm_ret()
 
 void Code::asm_code_inject(HANDLE handle)
 {
-    LPVOID addr = VirtualAllocEx(handle, nullptr, this->length, //
-                                 MEM_COMMIT, PAGE_EXECUTE_READWRITE);
-    if (addr == nullptr)
-        return;
+    if (this->remote == nullptr || this->remote_size < this->length)
+    {
+        asm_free_remote(handle);
+        unsigned int size = (this->length + 4095) / 4096 * 4096;
+        this->remote = VirtualAllocEx(handle, nullptr, size, //
+                                      MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+        if (this->remote == nullptr)
+            return;
+        this->remote_size = size;
+    }
+    LPVOID addr = this->remote;
 
     for (size_t i = 0; i < this->calls_pos.size(); i++)
     {
@@ -126,22 +135,15 @@ void Code::asm_code_inject(HANDLE handle)
     DWORD write_size = 0;
     BOOL ret = WriteProcessMemory(handle, addr, this->code, this->length, &write_size);
     if (ret == 0 || write_size != this->length)
-    {
-        VirtualFreeEx(handle, addr, 0, MEM_RELEASE);
         return;
-    }
 
     HANDLE thread = CreateRemoteThread //
         (handle, nullptr, 0, LPTHREAD_START_ROUTINE(addr), nullptr, 0, nullptr);
     if (thread == nullptr)
-    {
-        VirtualFreeEx(handle, addr, 0, MEM_RELEASE);
         return;
-    }
 
     DWORD wait_status = WaitForSingleObject(thread, INFINITE); // INFINITE?
     CloseHandle(thread);
-    VirtualFreeEx(handle, addr, 0, MEM_RELEASE);
 
 #ifdef _DEBUG
     std::wcout << L"等待状态: " << wait_status << std::endl;
@@ -154,4 +156,12 @@ void Code::asm_code_inject(HANDLE handle)
 #endif
 }
 
+void Code::asm_free_remote(HANDLE handle)
+{
+    if (this->remote != nullptr && handle != nullptr)
+        VirtualFreeEx(handle, this->remote, 0, MEM_RELEASE);
+    this->remote = nullptr;
+    this->remote_size = 0;
+}
+
 } // namespace Pt
@@ -58,10 +58,17 @@ class Code
 
     void asm_code_inject(HANDLE);
 
+    // 释放目标进程里的代码内存
+    void asm_free_remote(HANDLE);
+
   protected:
     unsigned char *code;
     unsigned int length;
     std::vector<unsigned int> calls_pos;
+
+    // 目标进程里复用的代码内存, 不够大时才重新申请
+    void *remote;
+    unsigned int remote_size;
 };
 
 template <typename... Args>
@@ -0,0 +1,755 @@
+
+#include <bit>
+#include <algorithm>
+#include <string>
+
+#include "library.h"
+#include "simd.h"
+
+namespace Pt
+{
+
+LineupData CanonicalLineup(const LineupData &data)
+{
+    LineupData result = data;
+
+    size_t rows = (data.scene == 2 || data.scene == 3) ? 6 : 5;
+    bool day = data.scene == 0 || data.scene == 2 || data.scene == 4;
+
+    for (size_t i = 0; i < GRID; i++)
+    {
+        if (i >= rows * 9)
+        {
+            result.items[i] = 0;
+            continue;
+        }
+
+        // 主要植物, 布阵时会跳过的类型当作空格
+        int plant_type = (int)result.plant()[i] - 1;
+        if (plant_type < 0 || plant_type > 47       //
+            || plant_type == 16 || plant_type == 33 //
+            || plant_type == 30 || plant_type == 35)
+        {
+            result.plant()[i] = 0;
+            result.plant_im()[i] = 0;
+            result.plant_awake()[i] = 0;
+        }
+        else if (!(day && Lineup::may_sleep[plant_type])) // 只有白天的蘑菇才区分睡着和醒着
+        {
+            result.plant_awake()[i] = 1;
+        }
+
+        // 墓碑没有模仿者
+        if (result.base()[i] == 0 || result.base()[i] == 3)
+            result.base_im()[i] = 0;
+        if (result.pumpkin()[i] == 0)
+            result.pumpkin_im()[i] = 0;
+        if (result.coffee()[i] == 0)
+            result.coffee_im()[i] = 0;
+    }
+
+    return result;
+}
+
+static uint64_t hash_canonical(const LineupData &canonical)
+{
+    // 每次取 4 格 (64 位) 混合
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ ((uint64_t)canonical.scene << 8) ^ canonical.rake_row;
+    for (size_t i = 0; i < GRID; i += 4)
+    {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 4 && i + j < GRID; j++)
+            word |= (uint64_t)canonical.items[i + j] << (16 * j);
+        h = (h ^ word) * 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 31;
+    }
+
+    // splitmix64 收尾
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+uint64_t LineupHash(const LineupData &data)
+{
+    return hash_canonical(CanonicalLineup(data));
+}
+
+LineupIndex::LineupIndex()
+{
+}
+
+LineupIndex::~LineupIndex()
+{
+}
+
+bool LineupIndex::same(const LineupData &a, const LineupData &b)
+{
+    return a.scene == b.scene          //
+           && a.rake_row == b.rake_row //
+           && memcmp(a.items, b.items, sizeof(a.items)) == 0;
+}
+
+size_t LineupIndex::Insert(const LineupData &data, size_t id)
+{
+    LineupData canonical = CanonicalLineup(data);
+    uint64_t hash = hash_canonical(canonical);
+
+    auto [begin, end] = entries.equal_range(hash);
+    for (auto it = begin; it != end; ++it)
+        if (same(it->second.data, canonical))
+            return it->second.id;
+
+    entries.emplace(hash, ENTRY{canonical, id});
+    return id;
+}
+
+size_t LineupIndex::Find(const LineupData &data) const
+{
+    LineupData canonical = CanonicalLineup(data);
+    uint64_t hash = hash_canonical(canonical);
+
+    auto [begin, end] = entries.equal_range(hash);
+    for (auto it = begin; it != end; ++it)
+        if (same(it->second.data, canonical))
+            return it->second.id;
+
+    return LINEUP_NOT_FOUND;
+}
+
+void LineupIndex::Clear()
+{
+    entries.clear();
+}
+
+size_t LineupIndex::Size() const
+{
+    return entries.size();
+}
+
+// 距离计算时的分层, 每层是若干个位平面, 任意一个位不同就算这一格不同
+struct LINEUP_LAYER_WEIGHT
+{
+    uint16_t mask; // 包含的位平面
+    unsigned int weight;
+};
+
+static const LINEUP_LAYER_WEIGHT layer_weights[] = {
+    {0b1111110000000000, 4}, // 植物
+    {0b0000000011000000, 2}, // 睡莲 花盆 墓碑
+    {0b0000000000010000, 2}, // 南瓜
+    {0b0000000000000100, 1}, // 咖啡豆
+    {0b0000000000000001, 1}, // 梯子
+    {0b0000001100101010, 1}, // 模仿者 睡醒状态
+};
+
+static const unsigned int rake_weight = 1;
+
+LineupSearch::LineupSearch()
+{
+}
+
+LineupSearch::~LineupSearch()
+{
+}
+
+void LineupSearch::to_planes(const LineupData &data, uint64_t out[16])
+{
+    LineupData canonical = CanonicalLineup(data);
+    for (size_t b = 0; b < 16; b++)
+        out[b] = 0;
+    for (size_t i = 0; i < GRID; i++)
+        for (size_t b = 0; b < 16; b++)
+            out[b] |= (uint64_t)((canonical.items[i] >> b) & 1) << i;
+}
+
+void LineupSearch::Add(const LineupData &data, size_t id)
+{
+    uint64_t p[16];
+    to_planes(data, p);
+    for (size_t b = 0; b < 16; b++)
+        planes[b].push_back(p[b]);
+    scenes.push_back(data.scene);
+    rake_rows.push_back(data.rake_row);
+    ids.push_back(id);
+}
+
+void LineupSearch::Clear()
+{
+    for (size_t b = 0; b < 16; b++)
+        planes[b].clear();
+    scenes.clear();
+    rake_rows.clear();
+    ids.clear();
+}
+
+size_t LineupSearch::Size() const
+{
+    return ids.size();
+}
+
+static inline unsigned int plane_distance(const std::vector<uint64_t> *planes, size_t n, const uint64_t q[16])
+{
+    unsigned int distance = 0;
+    for (const auto &layer : layer_weights)
+    {
+        uint64_t diff = 0;
+        for (size_t b = 0; b < 16; b++)
+            if (layer.mask & (1 << b))
+                diff |= planes[b][n] ^ q[b];
+        distance += layer.weight * (unsigned int)std::popcount(diff);
+    }
+    return distance;
+}
+
+#if defined(PTK_SIMD_X86)
+
+// 每个 64 位通道的 popcount, 按半字节查表再用 sad 横向相加
+PTK_TARGET_AVX2
+static inline __m256i popcount_epi64(__m256i v)
+{
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, //
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(v, low_mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    __m256i count = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+    return _mm256_sad_epu8(count, _mm256_setzero_si256());
+}
+
+// 一次算 4 个阵型, 返回处理到的位置, 剩下的交给标量
+PTK_TARGET_AVX2
+static size_t distances_avx2(const std::vector<uint64_t> *planes, size_t count, const uint64_t q[16], unsigned int *out)
+{
+    __m256i query[16];
+    for (size_t b = 0; b < 16; b++)
+        query[b] = _mm256_set1_epi64x((long long)q[b]);
+
+    size_t n = 0;
+    for (; n + 4 <= count; n += 4)
+    {
+        __m256i x[16];
+        for (size_t b = 0; b < 16; b++)
+            x[b] = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(planes[b].data() + n)), query[b]);
+
+        __m256i sum = _mm256_setzero_si256();
+        for (const auto &layer : layer_weights)
+        {
+            __m256i diff = _mm256_setzero_si256();
+            for (size_t b = 0; b < 16; b++)
+                if (layer.mask & (1 << b))
+                    diff = _mm256_or_si256(diff, x[b]);
+            __m256i weighted = _mm256_mul_epu32(popcount_epi64(diff), _mm256_set1_epi64x(layer.weight));
+            sum = _mm256_add_epi64(sum, weighted);
+        }
+
+        alignas(32) uint64_t result[4];
+        _mm256_store_si256((__m256i *)result, sum);
+        for (size_t i = 0; i < 4; i++)
+            out[n + i] = (unsigned int)result[i];
+    }
+    return n;
+}
+
+#endif
+
+std::vector<LINEUP_MATCH> LineupSearch::Nearest(const LineupData &data, size_t k) const
+{
+    std::vector<LINEUP_MATCH> matches;
+    size_t count = ids.size();
+    if (count == 0 || k == 0)
+        return matches;
+
+    uint64_t q[16];
+    to_planes(data, q);
+
+    std::vector<unsigned int> distances(count);
+    size_t n = 0;
+#if defined(PTK_SIMD_X86)
+    if (CpuHasAVX2())
+        n = distances_avx2(planes, count, q, distances.data());
+#endif
+    for (; n < count; n++)
+        distances[n] = plane_distance(planes, n, q);
+
+    matches.reserve(count);
+    for (n = 0; n < count; n++)
+    {
+        if (scenes[n] != data.scene)
+            continue;
+        unsigned int distance = distances[n] + ((rake_rows[n] != data.rake_row) ? rake_weight : 0);
+        matches.push_back({ids[n], distance});
+    }
+
+    auto LessThan = [](const LINEUP_MATCH &m1, const LINEUP_MATCH &m2)
+    { return m1.distance < m2.distance || (m1.distance == m2.distance && m1.id < m2.id); };
+    if (matches.size() > k)
+    {
+        std::nth_element(matches.begin(), matches.begin() + k, matches.end(), LessThan);
+        matches.resize(k);
+    }
+    std::sort(matches.begin(), matches.end(), LessThan);
+
+    return matches;
+}
+
+static const char *const scene_names[][6] = {
+    {"day", "night", "pool", "fog", "roof", "moon"},
+    {"白天", "黑夜", "泳池", "雾夜", "屋顶", "月夜"},
+};
+
+// 名字比较时忽略 ASCII 大小写, 下划线当作空格
+static std::string normalize_name(std::string_view name)
+{
+    std::string result;
+    result.reserve(name.size());
+    for (char ch : name)
+    {
+        if (ch == '_')
+            result += ' ';
+        else if (ch >= 'A' && ch <= 'Z')
+            result += (char)(ch - 'A' + 'a');
+        else
+            result += ch;
+    }
+    return result;
+}
+
+LineupQuery::LineupQuery()
+{
+}
+
+LineupQuery::~LineupQuery()
+{
+}
+
+bool LineupQuery::Empty() const
+{
+    return clauses.empty();
+}
+
+bool LineupQuery::parse_term(std::string_view term, std::initializer_list<std::span<const char *const>> names,
+                             LINEUP_CONDITION &condition)
+{
+    condition.negate = false;
+    if (!term.empty() && (term[0] == '!' || term[0] == '-'))
+    {
+        condition.negate = true;
+        term.remove_prefix(1);
+    }
+
+    // 名字部分, 引号里的比较符号不算
+    std::string name;
+    size_t i = 0;
+    bool quoted = false;
+    for (; i < term.size(); i++)
+    {
+        char ch = term[i];
+        if (ch == '"')
+        {
+            quoted = !quoted;
+            continue;
+        }
+        if (!quoted && (ch == '<' || ch == '>' || ch == '='))
+            break;
+        name += ch;
+    }
+    name = normalize_name(name);
+    if (name.empty())
+        return false;
+
+    // 比较符号和数字
+    std::string_view op = term.substr(i, 0);
+    if (i < term.size())
+    {
+        size_t len = (i + 1 < term.size() && term[i + 1] == '=' && term[i] != '=') ? 2 : 1;
+        op = term.substr(i, len);
+        i += len;
+    }
+    int number = 0;
+    size_t digits = 0;
+    for (; i < term.size() && term[i] >= '0' && term[i] <= '9' && digits < 3; i++, digits++)
+        number = number * 10 + (term[i] - '0');
+    if (i != term.size() || (!op.empty() && digits == 0) || number > 255)
+        return false;
+
+    // 默认是至少有一个
+    condition.min = 1;
+    condition.max = 255;
+    if (op == ">=")
+        condition.min = (uint8_t)number;
+    else if (op == ">" && number < 255)
+        condition.min = (uint8_t)(number + 1);
+    else if (op == "<=")
+        condition.min = 0, condition.max = (uint8_t)number;
+    else if (op == "<" && number > 0)
+        condition.min = 0, condition.max = (uint8_t)(number - 1);
+    else if (op == "=")
+        condition.min = condition.max = (uint8_t)number;
+    else if (!op.empty())
+        return false;
+
+    if (name == "scene" || name == "场地")
+    {
+        if (op.empty())
+            return false;
+        condition.attr = LINEUP_ATTR_SCENE;
+        return true;
+    }
+    for (const auto &list : scene_names)
+    {
+        for (uint8_t s = 0; s < 6; s++)
+        {
+            if (name == list[s])
+            {
+                if (!op.empty())
+                    return false;
+                condition.attr = LINEUP_ATTR_SCENE;
+                condition.min = condition.max = s;
+                return true;
+            }
+        }
+    }
+    if (name == "rake" || name == "钉耙")
+    {
+        condition.attr = LINEUP_ATTR_RAKE;
+        return true;
+    }
+    if (name == "ladder" || name == "梯子")
+    {
+        condition.attr = LINEUP_ATTR_LADDER;
+        return true;
+    }
+
+    // #序号
+    if (name[0] == '#')
+    {
+        if (name.size() < 2 || name.size() > 3)
+            return false;
+        int type = 0;
+        for (size_t j = 1; j < name.size(); j++)
+        {
+            if (name[j] < '0' || name[j] > '9')
+                return false;
+            type = type * 10 + (name[j] - '0');
+        }
+        if (type > 47)
+            return false;
+        condition.attr = (uint8_t)type;
+        return true;
+    }
+
+    // 先找完全相同的名字, 没有的话找唯一以它开头的
+    int prefix_type = -1;
+    bool ambiguous = false;
+    for (const auto &list : names)
+    {
+        for (size_t type = 0; type < list.size() && type < 48; type++)
+        {
+            std::string plant = normalize_name(list[type]);
+            if (plant == name)
+            {
+                condition.attr = (uint8_t)type;
+                return true;
+            }
+            if (plant.compare(0, name.size(), name) == 0)
+            {
+                if (prefix_type != -1 && prefix_type != (int)type)
+                    ambiguous = true;
+                prefix_type = (int)type;
+            }
+        }
+    }
+    if (prefix_type == -1 || ambiguous)
+        return false;
+    condition.attr = (uint8_t)prefix_type;
+    return true;
+}
+
+bool LineupQuery::Parse(std::string_view text, std::initializer_list<std::span<const char *const>> names)
+{
+    clauses.clear();
+
+    std::vector<LINEUP_CONDITION> clause;
+    size_t i = 0;
+    while (true)
+    {
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\t'))
+            i++;
+        if (i >= text.size())
+            break;
+
+        if (text[i] == '|')
+        {
+            if (clause.empty())
+            {
+                clauses.clear();
+                return false;
+            }
+            clauses.push_back(std::move(clause));
+            clause.clear();
+            i++;
+            continue;
+        }
+
+        size_t begin = i;
+        bool quoted = false;
+        for (; i < text.size(); i++)
+        {
+            if (text[i] == '"')
+                quoted = !quoted;
+            else if (!quoted && (text[i] == ' ' || text[i] == '\t' || text[i] == '|'))
+                break;
+        }
+
+        LINEUP_CONDITION condition;
+        if (quoted || !parse_term(text.substr(begin, i - begin), names, condition))
+        {
+            clauses.clear();
+            return false;
+        }
+        clause.push_back(condition);
+    }
+
+    if (clause.empty())
+    {
+        bool ok = clauses.empty(); // 最后是 | 的不行
+        clauses.clear();
+        return ok;
+    }
+    clauses.push_back(std::move(clause));
+    return true;
+}
+
+LineupFilter::LineupFilter()
+{
+}
+
+LineupFilter::~LineupFilter()
+{
+}
+
+void LineupFilter::count_attrs(const LineupData &data, uint8_t out[LINEUP_COUNT_ATTRS])
+{
+    LineupData canonical = CanonicalLineup(data); // 超出场地的格子已经清空
+    memset(out, 0, LINEUP_COUNT_ATTRS);
+    for (size_t i = 0; i < GRID; i++)
+    {
+        int plant = canonical.plant()[i];
+        if (plant >= 1 && plant <= 48)
+            out[plant - 1]++;
+        if (canonical.base()[i] == 1)
+            out[16]++; // 睡莲
+        if (canonical.base()[i] == 2)
+            out[33]++; // 花盆
+        if (canonical.pumpkin()[i] == 1)
+            out[30]++; // 南瓜
+        if (canonical.coffee()[i] == 1)
+            out[35]++; // 咖啡豆
+        if (canonical.ladder()[i] == 1)
+            out[LINEUP_ATTR_LADDER]++;
+    }
+}
+
+size_t LineupFilter::Add(const LineupData &data)
+{
+    size_t id = count++;
+    size_t word = id / 64;
+    uint64_t bit = 1ull << (id % 64);
+
+    if (id % 64 == 0)
+    {
+        for (auto &bitmap : scene_bitmaps)
+            bitmap.push_back(0);
+        rake_bitmap.push_back(0);
+        for (auto &attr : count_bitmaps)
+            for (auto &bitmap : attr)
+                bitmap.push_back(0);
+    }
+
+    if (data.scene < 6)
+        scene_bitmaps[data.scene][word] |= bit;
+    if (data.rake_row != 0)
+        rake_bitmap[word] |= bit;
+
+    uint8_t c[LINEUP_COUNT_ATTRS];
+    count_attrs(data, c);
+    for (size_t a = 0; a < LINEUP_COUNT_ATTRS; a++)
+        for (size_t t = 0; t < THRESHOLDS && c[a] >= thresholds[t]; t++)
+            count_bitmaps[a][t][word] |= bit;
+    counts.insert(counts.end(), c, c + LINEUP_COUNT_ATTRS);
+
+    return id;
+}
+
+void LineupFilter::Clear()
+{
+    count = 0;
+    for (auto &bitmap : scene_bitmaps)
+        bitmap.clear();
+    rake_bitmap.clear();
+    for (auto &attr : count_bitmaps)
+        for (auto &bitmap : attr)
+            bitmap.clear();
+    counts.clear();
+}
+
+size_t LineupFilter::Size() const
+{
+    return count;
+}
+
+uint8_t LineupFilter::value(size_t id, uint8_t attr) const
+{
+    if (attr < LINEUP_COUNT_ATTRS)
+        return counts[id * LINEUP_COUNT_ATTRS + attr];
+
+    uint64_t bit = 1ull << (id % 64);
+    if (attr == LINEUP_ATTR_RAKE)
+        return (rake_bitmap[id / 64] & bit) ? 1 : 0;
+    for (uint8_t s = 0; s < 6; s++) // LINEUP_ATTR_SCENE
+        if (scene_bitmaps[s][id / 64] & bit)
+            return s;
+    return 0xff;
+}
+
+bool LineupFilter::test_condition(const LINEUP_CONDITION &condition, size_t id) const
+{
+    uint8_t v = value(id, condition.attr);
+    bool match = v >= condition.min && v <= condition.max;
+    return match != condition.negate;
+}
+
+bool LineupFilter::Test(const LineupQuery &query, size_t id) const
+{
+    if (id >= count)
+        return false;
+    if (query.Empty())
+        return true;
+
+    for (const auto &clause : query.clauses)
+    {
+        bool match = true;
+        for (const auto &condition : clause)
+        {
+            if (!test_condition(condition, id))
+            {
+                match = false;
+                break;
+            }
+        }
+        if (match)
+            return true;
+    }
+    return false;
+}
+
+void LineupFilter::eval_condition(const LINEUP_CONDITION &condition, std::vector<uint64_t> &out) const
+{
+    size_t words = out.size();
+    bool exact = true;
+
+    if (condition.attr == LINEUP_ATTR_SCENE)
+    {
+        std::fill(out.begin(), out.end(), 0);
+        for (size_t s = condition.min; s <= condition.max && s < 6; s++)
+            for (size_t w = 0; w < words; w++)
+                out[w] |= scene_bitmaps[s][w];
+    }
+    else if (condition.attr == LINEUP_ATTR_RAKE)
+    {
+        bool with = condition.min <= 1 && condition.max >= 1;
+        bool without = condition.min == 0;
+        for (size_t w = 0; w < words; w++)
+            out[w] = (with ? rake_bitmap[w] : 0) | (without ? ~rake_bitmap[w] : 0);
+    }
+    else
+    {
+        const auto &bitmaps = count_bitmaps[condition.attr];
+
+        // 下限: 不超过 min 的最大阈值, "数量 >= 阈值" 包含了所有满足的
+        std::fill(out.begin(), out.end(), ~0ull);
+        if (condition.min > 0)
+        {
+            size_t t = 0;
+            while (t + 1 < THRESHOLDS && thresholds[t + 1] <= condition.min)
+                t++;
+            exact = exact && thresholds[t] == condition.min;
+            for (size_t w = 0; w < words; w++)
+                out[w] &= bitmaps[t][w];
+        }
+
+        // 上限: 不小于 max + 1 的最小阈值, 去掉 "数量 >= 阈值" 的
+        if (condition.max < 255)
+        {
+            size_t t = 0;
+            while (t < THRESHOLDS && thresholds[t] < condition.max + 1)
+                t++;
+            if (t < THRESHOLDS)
+            {
+                exact = exact && thresholds[t] == condition.max + 1;
+                for (size_t w = 0; w < words; w++)
+                    out[w] &= ~bitmaps[t][w];
+            }
+            else
+            {
+                exact = false;
+            }
+        }
+    }
+
+    if (words > 0 && count % 64 != 0)
+        out[words - 1] &= (1ull << (count % 64)) - 1;
+
+    // 不在阈值上的, 候选逐个核对
+    if (!exact)
+    {
+        for (size_t w = 0; w < words; w++)
+        {
+            uint64_t bits = out[w];
+            while (bits != 0)
+            {
+                size_t b = (size_t)std::countr_zero(bits);
+                bits &= bits - 1;
+                uint8_t v = counts[(w * 64 + b) * LINEUP_COUNT_ATTRS + condition.attr];
+                if (v < condition.min || v > condition.max)
+                    out[w] &= ~(1ull << b);
+            }
+        }
+    }
+
+    if (condition.negate)
+        for (size_t w = 0; w < words; w++)
+            out[w] = ~out[w];
+}
+
+std::vector<uint64_t> LineupFilter::Evaluate(const LineupQuery &query) const
+{
+    size_t words = (count + 63) / 64;
+    std::vector<uint64_t> result(words, query.Empty() ? ~0ull : 0);
+
+    std::vector<uint64_t> clause_bits(words);
+    std::vector<uint64_t> condition_bits(words);
+    for (const auto &clause : query.clauses)
+    {
+        std::fill(clause_bits.begin(), clause_bits.end(), ~0ull);
+        for (const auto &condition : clause)
+        {
+            eval_condition(condition, condition_bits);
+            for (size_t w = 0; w < words; w++)
+                clause_bits[w] &= condition_bits[w];
+        }
+        for (size_t w = 0; w < words; w++)
+            result[w] |= clause_bits[w];
+    }
+
+    if (words > 0 && count % 64 != 0)
+        result[words - 1] &= (1ull << (count % 64)) - 1;
+
+    return result;
+}
+
+} // namespace Pt
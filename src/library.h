@@ -0,0 +1,160 @@
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <string_view>
+#include <span>
+#include <initializer_list>
+
+#include "lineup.h"
+
+namespace Pt
+{
+
+#define LINEUP_NOT_FOUND ((size_t)-1)
+
+// 规范化的阵型数据, 清掉不影响布阵结果的位, 超出场地行数的格子也清空
+// 编码不同但是布出来一样的阵型, 规范化之后完全相同
+LineupData CanonicalLineup(const LineupData &);
+
+// 规范化之后的 64 位哈希, 包括棋盘, 场地和钉耙
+uint64_t LineupHash(const LineupData &);
+
+// 阵型哈希索引, 用于导入时去重和查找已有的阵型
+class LineupIndex
+{
+  public:
+    LineupIndex();
+    ~LineupIndex();
+
+    // 插入阵型, 已经有相同的阵型时不插入, 返回已有阵型的序号, 否则返回 id
+    size_t Insert(const LineupData &, size_t id);
+
+    // 查找相同的阵型, 没有的话返回 LINEUP_NOT_FOUND
+    size_t Find(const LineupData &) const;
+
+    void Clear();
+    size_t Size() const;
+
+  private:
+    struct ENTRY
+    {
+        LineupData data; // 规范化的
+        size_t id;
+    };
+
+    std::unordered_multimap<uint64_t, ENTRY> entries;
+
+    static bool same(const LineupData &, const LineupData &);
+};
+
+struct LINEUP_MATCH
+{
+    size_t id;             // 插入时给的序号
+    unsigned int distance; // 越小越像, 0 表示布出来完全一样
+};
+
+// 相似阵型搜索
+// 每个阵型按规范化数据的 16 个位拆成 16 个位平面, 每个位平面用一个 64 位整数表示 54 格
+// 距离是各层不同格子数的加权和, 对整个库做一次遍历 (支持 AVX2 时一次算 4 个), 再取前 k 个
+class LineupSearch
+{
+  public:
+    LineupSearch();
+    ~LineupSearch();
+
+    void Add(const LineupData &, size_t id);
+    void Clear();
+    size_t Size() const;
+
+    // 只在相同场地的阵型里找, 按距离从小到大返回最多 k 个
+    std::vector<LINEUP_MATCH> Nearest(const LineupData &, size_t k) const;
+
+  private:
+    std::vector<uint64_t> planes[16]; // 按位平面分开存放, 方便一次读连续的 4 个
+    std::vector<uint8_t> scenes;
+    std::vector<uint8_t> rake_rows;
+    std::vector<size_t> ids;
+
+    static void to_planes(const LineupData &, uint64_t[16]);
+};
+
+// 阵型筛选的属性, 0 - 47 是植物种类的数量
+#define LINEUP_ATTR_LADDER 48 // 梯子数量
+#define LINEUP_ATTR_SCENE 49  // 场地
+#define LINEUP_ATTR_RAKE 50   // 有没有钉耙
+
+#define LINEUP_COUNT_ATTRS 49 // 按数量统计的属性个数
+
+// 一个筛选条件, 属性的值在 [min, max] 之内 (negate 时取反)
+struct LINEUP_CONDITION
+{
+    uint8_t attr;
+    uint8_t min;
+    uint8_t max;
+    bool negate;
+};
+
+// 阵型筛选条件, 若干个分支满足任意一个即可, 每个分支里的条件要同时满足
+// 语法: 空格分隔的条件同时满足, | 分隔分支, 条件前面加 ! 或者 - 表示取反
+//   泳池 pool scene=2         场地
+//   玉米加农炮 "Cob Cannon" #47 至少有一个, 名字可以只写开头 (不能有歧义)
+//   玉米加农炮>=8              数量比较, 支持 >= > <= < =
+//   梯子 ladder 钉耙 rake
+class LineupQuery
+{
+  public:
+    LineupQuery();
+    ~LineupQuery();
+
+    // 解析失败时返回 false, names 是用来匹配植物名字的名字表 (每个 48 项)
+    bool Parse(std::string_view, std::initializer_list<std::span<const char *const>> names = {});
+    bool Empty() const;
+
+    std::vector<std::vector<LINEUP_CONDITION>> clauses;
+
+  private:
+    bool parse_term(std::string_view, std::initializer_list<std::span<const char *const>>, LINEUP_CONDITION &);
+};
+
+// 阵型位图索引, 每个属性的每个取值区间一个位图, 每个阵型占一位
+// 场地每种一个位图, 数量按若干个阈值分桶, 每个阈值一个 "数量 >= 阈值" 的位图
+// 查询时按 64 位整数逐字做与/或, 条件的数量不在阈值上时先用桶取出候选再逐个核对
+class LineupFilter
+{
+  public:
+    LineupFilter();
+    ~LineupFilter();
+
+    // 序号就是加入的顺序, 从 0 开始连续
+    size_t Add(const LineupData &);
+    void Clear();
+    size_t Size() const;
+
+    // 返回满足条件的阵型的位图, 第 i 位表示序号为 i 的阵型
+    std::vector<uint64_t> Evaluate(const LineupQuery &) const;
+
+    // 单个阵型是否满足条件
+    bool Test(const LineupQuery &, size_t) const;
+
+    static constexpr uint8_t thresholds[] = {1, 2, 3, 4, 6, 8, 12, 16, 24, 32};
+    static constexpr size_t THRESHOLDS = sizeof(thresholds) / sizeof(thresholds[0]);
+
+  private:
+    size_t count = 0;
+    std::vector<uint64_t> scene_bitmaps[6];
+    std::vector<uint64_t> rake_bitmap;
+    std::vector<uint64_t> count_bitmaps[LINEUP_COUNT_ATTRS][THRESHOLDS];
+    std::vector<uint8_t> counts; // 每个阵型 LINEUP_COUNT_ATTRS 个, 用于核对
+
+    uint8_t value(size_t, uint8_t) const;
+    bool test_condition(const LINEUP_CONDITION &, size_t) const;
+    void eval_condition(const LINEUP_CONDITION &, std::vector<uint64_t> &) const;
+
+    static void count_attrs(const LineupData &, uint8_t[LINEUP_COUNT_ATTRS]);
+};
+
+} // namespace Pt
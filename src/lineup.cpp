@@ -1,4 +1,8 @@
 
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
 #include "lineup.h"
 
 namespace Pt
@@ -22,6 +26,19 @@ Lineup::Lineup(std::string name, std::string string)
     this->lineup_name = name;
 }
 
+Lineup::Lineup(std::string name, std::string code, const LINEUP_DECODE_RESULT &result)
+{
+    reset_data();
+    this->lineup_name = name;
+    this->lineup_code = code;
+    if (result.error == LINEUP_DECODE_OK)
+    {
+        static_cast<LineupData &>(*this) = result.data;
+        this->ok = true;
+    }
+    compute_weight();
+}
+
 Lineup::~Lineup()
 {
 }
@@ -30,17 +47,6 @@ void Lineup::reset_data()
 {
     this->ok = false;
 
-    memset(this->plant, 0, GRID * sizeof(uint16_t));
-    memset(this->plant_im, 0, GRID * sizeof(uint16_t));
-    memset(this->plant_awake, 0, GRID * sizeof(uint16_t));
-    memset(this->base, 0, GRID * sizeof(uint16_t));
-    memset(this->base_im, 0, GRID * sizeof(uint16_t));
-    memset(this->pumpkin, 0, GRID * sizeof(uint16_t));
-    memset(this->pumpkin_im, 0, GRID * sizeof(uint16_t));
-    memset(this->coffee, 0, GRID * sizeof(uint16_t));
-    memset(this->coffee_im, 0, GRID * sizeof(uint16_t));
-    memset(this->ladder, 0, GRID * sizeof(uint16_t));
-
     memset(this->items, 0, GRID * sizeof(uint16_t));
 
     this->rake_row = 0;
@@ -55,10 +61,7 @@ void Lineup::reset_data()
 
 void Lineup::Init(const std::string &string)
 {
-    std::regex regex_string("[0-5](,[a-fA-F0-9]{1,2} [1-6] [1-9] [0-2] [0-4]( [a-zA-Z0-9]{1,}){0,}){0,}");
-    std::regex regex_code("[a-zA-Z0-9+/=]{18,164}");
-
-    if (std::regex_match(string, regex_string))
+    if (IsLineupString(string))
     {
         this->lineup_string = string;
         if (lineup_string_to_data())
@@ -66,36 +69,38 @@ void Lineup::Init(const std::string &string)
             this->ok = true;
         }
     }
-    else if (std::regex_match(string, regex_code) //
-             && string.size() % 4 == 0            //
-             && std::count(string.begin(), string.end(), '=') <= 2)
+    else if (IsLineupCode(string))
     {
         this->lineup_code = string;
         if (lineup_code_to_data())
         {
             this->ok = true;
-            decompress_data();
         }
     }
 
-    this->weight += this->scene * 10000000000000000;
+    compute_weight();
+}
+
+void Lineup::compute_weight()
+{
+    this->weight = this->scene * 10000000000000000;
     for (int i = 0; i < GRID; i++)
     {
-        if (plant[i] == 48)
+        if (plant()[i] == 48)
             this->weight += 100000000000000; // 春哥
-        if (plant[i] == 43)
+        if (plant()[i] == 43)
             this->weight += 1000000000000; // 曾哥
-        if (plant[i] == 42)
+        if (plant()[i] == 42)
             this->weight += 10000000000; // 双子
-        if (plant[i] == 45)
+        if (plant()[i] == 45)
             this->weight += 100000000; // 冰瓜
-        if (pumpkin[i] == 1)
+        if (pumpkin()[i] == 1)
             this->weight += 1000000; // 南瓜
-        if (base[i] == 1)
+        if (base()[i] == 1)
             this->weight += 10000; // 睡莲
-        if (base[i] == 2)
+        if (base()[i] == 2)
             this->weight += 100; // 花盆
-        if (ladder[i] == 1)
+        if (ladder()[i] == 1)
             this->weight += 1; // 梯子
     }
 }
@@ -107,12 +112,112 @@ bool Lineup::OK()
 
 std::string Lineup::Generate()
 {
-    compress_data();
     data_to_lineup_code();
 
     return this->lineup_code;
 }
 
+static inline bool is_alnum(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static inline bool is_hex(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static inline bool is_base64(char c)
+{
+    return is_alnum(c) || c == '+' || c == '/' || c == '=';
+}
+
+bool Lineup::IsLineupString(std::string_view str)
+{
+    size_t n = str.size();
+    size_t i = 0;
+
+    // 场地
+    if (n == 0 || str[i] < '0' || str[i] > '5')
+        return false;
+    i++;
+
+    // 每个物品: ,类型 行 列 状态 层级 [其他]...
+    auto digit_in = [&](char lo, char hi)
+    {
+        if (i + 1 >= n || str[i] != ' ' || str[i + 1] < lo || str[i + 1] > hi)
+            return false;
+        i += 2;
+        return true;
+    };
+
+    while (i < n)
+    {
+        if (str[i] != ',')
+            return false;
+        i++;
+
+        size_t hex_count = 0;
+        while (i < n && hex_count < 2 && is_hex(str[i]))
+            i++, hex_count++;
+        if (hex_count == 0)
+            return false;
+
+        if (!digit_in('1', '6') || !digit_in('1', '9') || !digit_in('0', '2') || !digit_in('0', '4'))
+            return false;
+
+        while (i < n && str[i] == ' ')
+        {
+            i++;
+            size_t alnum_count = 0;
+            while (i < n && is_alnum(str[i]))
+                i++, alnum_count++;
+            if (alnum_count == 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool Lineup::IsLineupCode(std::string_view str)
+{
+    if (str.size() < 18 || str.size() > 164 || str.size() % 4 != 0)
+        return false;
+
+    size_t padding = 0;
+    for (char c : str)
+    {
+        if (!is_base64(c))
+            return false;
+        if (c == '=')
+            padding++;
+    }
+
+    return padding <= 2;
+}
+
+bool Lineup::ParseListLine(const std::string &str, std::string &name, std::string &code)
+{
+    // 等价于 "\".*\": [a-zA-Z0-9+/=]{1,}"
+    // 代码里没有空格, 所以最后一个空格就是名称和代码的分界
+    size_t p = str.find_last_of(' ');
+    if (p == std::string::npos || p < 3 || p + 1 >= str.size())
+        return false;
+    if (str[0] != '"' || str[p - 2] != '"' || str[p - 1] != ':')
+        return false;
+    for (size_t i = 1; i < p - 2; i++)
+        if (str[i] == '\r' || str[i] == '\n') // 正则里的 . 不匹配换行
+            return false;
+    for (size_t i = p + 1; i < str.size(); i++)
+        if (!is_base64(str[i]))
+            return false;
+
+    name = str.substr(1, p - 3);
+    code = str.substr(p + 1);
+    return true;
+}
+
 std::vector<std::string> Lineup::split(const std::string &string, char seperator)
 {
     std::vector<std::string> result;
@@ -169,38 +274,38 @@ bool Lineup::lineup_string_to_data()
         {
             int item_row = atoi(item_str[1].c_str()) - 1;
             int item_col = atoi(item_str[2].c_str()) - 1;
-            bool item_imitater = item_str[5] == "1";
-            this->base[item_row * 9 + item_col] = (item_type == 16) ? 1 : 2;
-            this->base_im[item_row * 9 + item_col] = item_imitater ? 1 : 0;
+            bool item_imitater = item_str.size() > 5 && item_str[5] == "1";
+            this->base()[item_row * 9 + item_col] = (item_type == 16) ? 1 : 2;
+            this->base_im()[item_row * 9 + item_col] = item_imitater ? 1 : 0;
         }
         else if (item_type == 50) // 墓碑
         {
             int item_row = atoi(item_str[1].c_str()) - 1;
             int item_col = atoi(item_str[2].c_str()) - 1;
-            this->base[item_row * 9 + item_col] = 3;
-            this->base_im[item_row * 9 + item_col] = 0;
+            this->base()[item_row * 9 + item_col] = 3;
+            this->base_im()[item_row * 9 + item_col] = 0;
         }
         else if (item_type == 30) // 南瓜
         {
             int item_row = atoi(item_str[1].c_str()) - 1;
             int item_col = atoi(item_str[2].c_str()) - 1;
-            bool item_imitater = item_str[5] == "1";
-            this->pumpkin[item_row * 9 + item_col] = 1;
-            this->pumpkin_im[item_row * 9 + item_col] = item_imitater ? 1 : 0;
+            bool item_imitater = item_str.size() > 5 && item_str[5] == "1";
+            this->pumpkin()[item_row * 9 + item_col] = 1;
+            this->pumpkin_im()[item_row * 9 + item_col] = item_imitater ? 1 : 0;
         }
         else if (item_type == 35) // 咖啡
         {
             int item_row = atoi(item_str[1].c_str()) - 1;
             int item_col = atoi(item_str[2].c_str()) - 1;
-            bool item_imitater = item_str[5] == "1";
-            this->coffee[item_row * 9 + item_col] = 1;
-            this->coffee_im[item_row * 9 + item_col] = item_imitater ? 1 : 0;
+            bool item_imitater = item_str.size() > 5 && item_str[5] == "1";
+            this->coffee()[item_row * 9 + item_col] = 1;
+            this->coffee_im()[item_row * 9 + item_col] = item_imitater ? 1 : 0;
         }
         else if (item_type == 48) // 梯子 0x30
         {
             int item_row = atoi(item_str[1].c_str()) - 1;
             int item_col = atoi(item_str[2].c_str()) - 1;
-            this->ladder[item_row * 9 + item_col] = 1;
+            this->ladder()[item_row * 9 + item_col] = 1;
         }
         else if (item_type == 49) // 钉耙 0x31
         {
@@ -212,116 +317,228 @@ bool Lineup::lineup_string_to_data()
             int item_row = atoi(item_str[1].c_str()) - 1;
             int item_col = atoi(item_str[2].c_str()) - 1;
             int item_state_row = atoi(item_str[3].c_str());
-            bool item_imitater = item_str[5] == "1";
-            this->plant[item_row * 9 + item_col] = item_type + 1;
-            this->plant_im[item_row * 9 + item_col] = item_imitater ? 1 : 0;
-            this->plant_awake[item_row * 9 + item_col] = ((scene == 0 || scene == 2 || scene == 4) //
-                                                          && this->may_sleep[item_type] && item_state_row == 0)
-                                                             ? 0
-                                                             : 1;
+            bool item_imitater = item_str.size() > 5 && item_str[5] == "1";
+            this->plant()[item_row * 9 + item_col] = item_type + 1;
+            this->plant_im()[item_row * 9 + item_col] = item_imitater ? 1 : 0;
+            this->plant_awake()[item_row * 9 + item_col] = ((scene == 0 || scene == 2 || scene == 4) //
+                                                            && this->may_sleep[item_type] && item_state_row == 0)
+                                                               ? 0
+                                                               : 1;
         }
     }
 
     return true;
 }
 
-bool Lineup::lineup_code_to_data()
+// 阵型代码解码器, z_stream 只初始化一次, 之后每个代码只需要 inflateReset
+class LineupDecoder
 {
-    if (this->lineup_code.empty())
-        return false;
+  public:
+    LineupDecoder()
+    {
+        memset(&strm, 0, sizeof(strm));
+        ready = inflateInit(&strm) == Z_OK;
+    }
 
-    unsigned long size = 128;
-    unsigned char buffer[128] = {0};
-    BOOL ret_decode = CryptStringToBinaryA(this->lineup_code.c_str(), 0, CRYPT_STRING_BASE64,
-                                           buffer, &size, nullptr, nullptr);
-    if (ret_decode == FALSE)
-        return false;
+    ~LineupDecoder()
+    {
+        if (ready)
+            inflateEnd(&strm);
+    }
 
-    for (size_t i = 0; i < size; i++)
-        buffer[i] = buffer[i] ^ (unsigned char)0x54;
+    LineupDecoder(const LineupDecoder &) = delete;
+    LineupDecoder &operator=(const LineupDecoder &) = delete;
 
-    this->rake_row = buffer[size - 1] >> 4;
-    this->scene = buffer[size - 1] & 0b00001111;
-    if (this->scene >= 6)
-        return false;
-    if (this->rake_row != 0 && this->rake_row > ((this->scene == 2 || this->scene == 3) ? 6 : 5))
-        return false;
-    if ((this->scene == 2 || this->scene == 3) && (this->rake_row == 3 || this->rake_row == 4))
-        return false;
+    void Decode(std::string_view code, LINEUP_DECODE_RESULT &result)
+    {
+        memset(result.data.items, 0, GRID * sizeof(uint16_t));
+        result.data.scene = 2;
+        result.data.rake_row = 0;
+        result.error = decode(code, result.data);
+    }
 
-    unsigned long cut_size = 6 * 9 * sizeof(uint16_t);
-    int ret_decomp = uncompress((unsigned char *)this->items, &cut_size, buffer, size - 1);
-    if (ret_decomp != Z_OK)
+  private:
+    z_stream strm;
+    bool ready;
+    unsigned char buffer[128]; // 最长 164 个字符, 解码后最多 123 字节
+
+    uint8_t decode(std::string_view code, LineupData &data)
+    {
+        if (!Lineup::IsLineupCode(code))
+            return LINEUP_DECODE_FORMAT_ERROR;
+
+        size_t size = sizeof(buffer);
+        if (!Base64Decode(code, buffer, size, 0x54) || size == 0)
+            return LINEUP_DECODE_BASE64_ERROR;
+
+        uint8_t rake_row = buffer[size - 1] >> 4;
+        uint8_t scene = buffer[size - 1] & 0b00001111;
+        if (scene >= 6)
+            return LINEUP_DECODE_SCENE_ERROR;
+        if (rake_row != 0 && rake_row > ((scene == 2 || scene == 3) ? 6 : 5))
+            return LINEUP_DECODE_SCENE_ERROR;
+        if ((scene == 2 || scene == 3) && (rake_row == 3 || rake_row == 4))
+            return LINEUP_DECODE_SCENE_ERROR;
+        data.scene = scene;
+        data.rake_row = rake_row;
+
+        if (!ready || inflateReset(&strm) != Z_OK)
+            return LINEUP_DECODE_INFLATE_ERROR;
+        strm.next_in = buffer;
+        strm.avail_in = (uInt)(size - 1);
+        strm.next_out = (Bytef *)data.items;
+        strm.avail_out = GRID * sizeof(uint16_t);
+        if (inflate(&strm, Z_FINISH) != Z_STREAM_END) // 和 uncompress 一样要求数据完整
+            return LINEUP_DECODE_INFLATE_ERROR;
+
+        size_t cut_size = GRID * sizeof(uint16_t) - strm.avail_out;
+        if (cut_size != ((scene == 2 || scene == 3) ? 6 : 5) * 9 * sizeof(uint16_t))
+            return LINEUP_DECODE_SIZE_ERROR;
+
+        return LINEUP_DECODE_OK;
+    }
+};
+
+bool Lineup::lineup_code_to_data()
+{
+    if (this->lineup_code.empty())
         return false;
-    if (cut_size != ((scene == 2 || scene == 3) ? 6 : 5) * 9 * sizeof(uint16_t))
+
+    static thread_local LineupDecoder decoder;
+    LINEUP_DECODE_RESULT result;
+    decoder.Decode(this->lineup_code, result);
+    if (result.error != LINEUP_DECODE_OK)
         return false;
 
+    static_cast<LineupData &>(*this) = result.data;
     return true;
 }
 
-void Lineup::data_to_lineup_code()
+std::vector<LINEUP_DECODE_RESULT> Lineup::DecodeMany(std::span<const std::string_view> codes, unsigned int threads)
 {
-    unsigned long size = 121; // compressBound(6*9*2)
-    unsigned char buffer[128] = {0};
-    unsigned long cut_size = ((this->scene == 2 || this->scene == 3) ? 6 : 5) * 9 * sizeof(uint16_t);
-    compress2(buffer, &size, (unsigned char *)this->items, cut_size, Z_BEST_COMPRESSION);
-    buffer[size - 1 + 1] = (this->rake_row << 4) | (this->scene & 0b00001111);
-
-    for (size_t i = 0; i < size + 1; i++)
-        buffer[i] = buffer[i] ^ (unsigned char)0x54;
-
-    DWORD len = 256;
-    char str[256] = {0};
-    CryptBinaryToStringA(buffer, size + 1, CRYPT_STRING_BASE64, str, &len);
-
-    std::string code(str);
-    code.erase(std::remove(code.begin(), code.end(), '\r'), code.end());
-    code.erase(std::remove(code.begin(), code.end(), '\n'), code.end());
-    // std::cout << lineup << " " << lineup.size() << std::endl;
-    lineup_code = code;
+    std::vector<LINEUP_DECODE_RESULT> results(codes.size());
+    if (codes.empty())
+        return results;
+
+    // 每个线程至少分到几百个, 太少了开线程不划算
+    const size_t min_per_thread = 256;
+    const size_t chunk = 64;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned int)std::min<size_t>(threads, (codes.size() + min_per_thread - 1) / min_per_thread);
+
+    std::atomic<size_t> next{0};
+    auto work = [&]()
+    {
+        LineupDecoder decoder;
+        size_t begin;
+        while ((begin = next.fetch_add(chunk)) < codes.size())
+        {
+            size_t end = std::min(begin + chunk, codes.size());
+            for (size_t i = begin; i < end; i++)
+                decoder.Decode(codes[i], results[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; i++)
+        workers.emplace_back(work);
+    work(); // 当前线程也干活
+    for (auto &t : workers)
+        t.join();
+
+    return results;
 }
 
-void Lineup::compress_data()
+// 阵型数据编码器, 一直用同一个 deflate 状态, 每次 deflateReset 而不是重新分配
+// 窗口 15 和 compress2(Z_BEST_COMPRESSION) 一样, memLevel 用 1 而不是默认的 8
+// deflateReset 要清空哈希表, memLevel 1 时只有 256 项 (8 时为 32768 项), 重置很便宜
+// 输入最多 108 字节, 输出和 compress2 仍然完全相同:
+// 符号缓冲区 127 个放得下全部符号, 不会提前分块; 哈希表变小只是链上多了冲突的位置,
+// 链长不超过输入长度, 远小于 9 级的 max_chain 4096, 真正匹配的位置按同样的顺序都会被比较到
+class LineupEncoder
 {
-    for (size_t r = 0; r < 6; r++)
+  public:
+    LineupEncoder()
+    {
+        memset(&strm, 0, sizeof(strm));
+        ready = deflateInit2(&strm, Z_BEST_COMPRESSION, Z_DEFLATED, 15, 1, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~LineupEncoder()
+    {
+        if (ready)
+            deflateEnd(&strm);
+    }
+
+    LineupEncoder(const LineupEncoder &) = delete;
+    LineupEncoder &operator=(const LineupEncoder &) = delete;
+
+    std::string Encode(const LineupData &data)
     {
-        for (size_t c = 0; c < 9; c++)
+        unsigned char buffer[128] = {0}; // compressBound(6*9*2) = 121
+        size_t cut_size = ((data.scene == 2 || data.scene == 3) ? 6 : 5) * 9 * sizeof(uint16_t);
+
+        size_t size = 0;
+        if (ready && deflateReset(&strm) == Z_OK)
         {
-            uint16_t item = 0;
-            item += 0b1111110000000000 & (this->plant[r * 9 + c] << 10);
-            item += 0b0000001000000000 & (this->plant_im[r * 9 + c] << 9);
-            item += 0b0000000100000000 & (this->plant_awake[r * 9 + c] << 8);
-            item += 0b0000000011000000 & (this->base[r * 9 + c] << 6);
-            item += 0b0000000000100000 & (this->base_im[r * 9 + c] << 5);
-            item += 0b0000000000010000 & (this->pumpkin[r * 9 + c] << 4);
-            item += 0b0000000000001000 & (this->pumpkin_im[r * 9 + c] << 3);
-            item += 0b0000000000000100 & (this->coffee[r * 9 + c] << 2);
-            item += 0b0000000000000010 & (this->coffee_im[r * 9 + c] << 1);
-            item += 0b0000000000000001 & (this->ladder[r * 9 + c] << 0);
-            this->items[r * 9 + c] = item;
+            strm.next_in = (Bytef *)data.items;
+            strm.avail_in = (uInt)cut_size;
+            strm.next_out = buffer;
+            strm.avail_out = 121;
+            if (deflate(&strm, Z_FINISH) == Z_STREAM_END)
+                size = 121 - strm.avail_out;
         }
+        buffer[size] = (data.rake_row << 4) | (data.scene & 0b00001111);
+
+        return Base64Encode(buffer, size + 1, 0x54);
     }
+
+  private:
+    z_stream strm;
+    bool ready;
+};
+
+void Lineup::data_to_lineup_code()
+{
+    static thread_local LineupEncoder encoder;
+    lineup_code = encoder.Encode(*this);
 }
 
-void Lineup::decompress_data()
+std::vector<std::string> Lineup::EncodeMany(std::span<const LineupData> lineups, unsigned int threads)
 {
-    for (size_t r = 0; r < 6; r++)
+    std::vector<std::string> codes(lineups.size());
+    if (lineups.empty())
+        return codes;
+
+    // 和 DecodeMany 一样分块, 每个线程一个编码器
+    const size_t min_per_thread = 256;
+    const size_t chunk = 64;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned int)std::min<size_t>(threads, (lineups.size() + min_per_thread - 1) / min_per_thread);
+
+    std::atomic<size_t> next{0};
+    auto work = [&]()
     {
-        for (size_t c = 0; c < 9; c++)
+        LineupEncoder encoder;
+        size_t begin;
+        while ((begin = next.fetch_add(chunk)) < lineups.size())
         {
-            uint16_t item = this->items[r * 9 + c];
-            this->plant[r * 9 + c] = (item & 0b1111110000000000) >> 10;
-            this->plant_im[r * 9 + c] = (item & 0b0000001000000000) >> 9;
-            this->plant_awake[r * 9 + c] = (item & 0b0000000100000000) >> 8;
-            this->base[r * 9 + c] = (item & 0b0000000011000000) >> 6;
-            this->base_im[r * 9 + c] = (item & 0b0000000000100000) >> 5;
-            this->pumpkin[r * 9 + c] = (item & 0b0000000000010000) >> 4;
-            this->pumpkin_im[r * 9 + c] = (item & 0b0000000000001000) >> 3;
-            this->coffee[r * 9 + c] = (item & 0b0000000000000100) >> 2;
-            this->coffee_im[r * 9 + c] = (item & 0b0000000000000010) >> 1;
-            this->ladder[r * 9 + c] = (item & 0b0000000000000001) >> 0;
+            size_t end = std::min(begin + chunk, lineups.size());
+            for (size_t i = begin; i < end; i++)
+                codes[i] = encoder.Encode(lineups[i]);
         }
-    }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; i++)
+        workers.emplace_back(work);
+    work(); // 当前线程也干活
+    for (auto &t : workers)
+        t.join();
+
+    return codes;
 }
 
 } // namespace Pt
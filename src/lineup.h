@@ -2,74 +2,174 @@
 #pragma once
 
 #include "zlib.h"
+#include "base64.h"
 
 #include <iostream>
-#include <regex>
+#include <string_view>
 #include <string>
 #include <vector>
+#include <span>
 #include <cassert>
 #include <fstream>
-
-#include <Windows.h>
+#include <cstring>
 
 namespace Pt
 {
 
 #define GRID (6 * 9)
 
-class Lineup
+// 批量解码的错误码
+#define LINEUP_DECODE_OK 0
+#define LINEUP_DECODE_FORMAT_ERROR 1  // 不是阵型代码
+#define LINEUP_DECODE_BASE64_ERROR 2  // Base64 解码失败
+#define LINEUP_DECODE_SCENE_ERROR 3   // 场地或者钉耙行数不对
+#define LINEUP_DECODE_INFLATE_ERROR 4 // 解压失败
+#define LINEUP_DECODE_SIZE_ERROR 5    // 解压后的大小和场地行数不符
+
+// 阵型数据里某一格某一层的读写代理, 赋值时只改对应的位
+template <int Shift, int Bits>
+class LineupLayerRef
+{
+  public:
+    static constexpr uint16_t Mask = (1 << Bits) - 1;
+
+    LineupLayerRef(uint16_t &item) : item(item) {}
+
+    operator uint16_t() const
+    {
+        return (item >> Shift) & Mask;
+    }
+
+    LineupLayerRef &operator=(uint16_t value)
+    {
+        item = (uint16_t)((item & ~(Mask << Shift)) | ((value & Mask) << Shift));
+        return *this;
+    }
+
+  private:
+    uint16_t &item;
+};
+
+// 阵型数据某一层的视图, 用起来和原来单独的数组一样
+template <int Shift, int Bits>
+class LineupLayer
+{
+  public:
+    LineupLayer(uint16_t *items) : items(items) {}
+
+    LineupLayerRef<Shift, Bits> operator[](size_t i) const
+    {
+        return LineupLayerRef<Shift, Bits>(items[i]);
+    }
+
+  private:
+    uint16_t *items;
+};
+
+template <int Shift, int Bits>
+class LineupConstLayer
+{
+  public:
+    LineupConstLayer(const uint16_t *items) : items(items) {}
+
+    uint16_t operator[](size_t i) const
+    {
+        return (items[i] >> Shift) & ((1 << Bits) - 1);
+    }
+
+  private:
+    const uint16_t *items;
+};
+
+// 紧凑的阵型数据, 每格一个 16 位整数, 和阵型代码里的格式一致
+// 植物 6 | 模仿者 1 | 醒着 1 | 睡莲花盆墓碑 2 | 模仿者 1 | 南瓜 1 | 模仿者 1 | 咖啡豆 1 | 模仿者 1 | 梯子 1
+struct LineupData
+{
+    uint16_t items[GRID];
+    uint8_t scene;
+    uint8_t rake_row;
+
+#define LINEUP_LAYER(name, shift, bits)                     \
+    LineupLayer<shift, bits> name()                         \
+    {                                                       \
+        return LineupLayer<shift, bits>(items);             \
+    }                                                       \
+    LineupConstLayer<shift, bits> name() const              \
+    {                                                       \
+        return LineupConstLayer<shift, bits>(items);        \
+    }
+
+    LINEUP_LAYER(plant, 10, 6)
+    LINEUP_LAYER(plant_im, 9, 1)
+    LINEUP_LAYER(plant_awake, 8, 1)
+    LINEUP_LAYER(base, 6, 2)
+    LINEUP_LAYER(base_im, 5, 1)
+    LINEUP_LAYER(pumpkin, 4, 1)
+    LINEUP_LAYER(pumpkin_im, 3, 1)
+    LINEUP_LAYER(coffee, 2, 1)
+    LINEUP_LAYER(coffee_im, 1, 1)
+    LINEUP_LAYER(ladder, 0, 1)
+
+#undef LINEUP_LAYER
+};
+
+struct LINEUP_DECODE_RESULT
+{
+    LineupData data;
+    uint8_t error;
+};
+
+class Lineup : public LineupData
 {
   public:
     Lineup();
     Lineup(std::string);
     Lineup(std::string, std::string);
+    Lineup(std::string, std::string, const LINEUP_DECODE_RESULT &); // 名称, 代码, 批量解码的结果
     ~Lineup();
 
-    bool may_sleep[48] = {false, false, false, false, false, false, false, false, //
-                          true, true, true, false, true, true, true, true,        //
-                          false, false, false, false, false, false, false, false, //
-                          true, false, false, false, false, false, false, true,   //
-                          false, false, false, false, false, false, false, false, //
-                          false, false, true, false, false, false, false, false}; //
+    static constexpr bool may_sleep[48] = {false, false, false, false, false, false, false, false, //
+                                           true, true, true, false, true, true, true, true,        //
+                                           false, false, false, false, false, false, false, false, //
+                                           true, false, false, false, false, false, false, true,   //
+                                           false, false, false, false, false, false, false, false, //
+                                           false, false, true, false, false, false, false, false}; //
 
     void Init(const std::string &); // 阵型字符串/代码 -> 数据
     bool OK();                      //
     std::string Generate();         // 填充数据 -> 阵型代码
 
+    // 格式检查, 单次扫描, 规则和原来的正则表达式完全一致
+    static bool IsLineupString(std::string_view); // [0-5](,[a-fA-F0-9]{1,2} [1-6] [1-9] [0-2] [0-4]( [a-zA-Z0-9]{1,}){0,}){0,}
+    static bool IsLineupCode(std::string_view);   // [a-zA-Z0-9+/=]{18,164} 长度为 4 的倍数 最多两个 =
+
+    // 解析阵型列表文件的一行, 格式为 "名称": 代码
+    static bool ParseListLine(const std::string &, std::string &, std::string &);
+
+    // 多线程批量解码阵型代码, 结果和输入一一对应, threads 为 0 时按 CPU 核心数
+    static std::vector<LINEUP_DECODE_RESULT> DecodeMany(std::span<const std::string_view>, unsigned int threads = 0);
+
+    // 多线程批量生成阵型代码, 和逐个 Generate() 的结果完全相同
+    static std::vector<std::string> EncodeMany(std::span<const LineupData>, unsigned int threads = 0);
+
     std::string lineup_name;   // 阵型名称
     std::string lineup_string; // 阵型字符串
     std::string lineup_code;   // 阵型代码
 
-    uint16_t plant[GRID];
-    uint16_t plant_im[GRID];
-    uint16_t plant_awake[GRID];
-    uint16_t base[GRID];
-    uint16_t base_im[GRID];
-    uint16_t pumpkin[GRID];
-    uint16_t pumpkin_im[GRID];
-    uint16_t coffee[GRID];
-    uint16_t coffee_im[GRID];
-    uint16_t ladder[GRID];
-
-    uint8_t rake_row;
-    uint8_t scene;
-
     long long weight; // 用于排序的权重
 
   private:
     void reset_data();
+    void compute_weight();
 
     bool ok;
-    uint16_t items[GRID]; // 压缩的
 
     std::vector<std::string> split(const std::string &, char);
     long hex2dec(const std::string &);
 
-    bool lineup_string_to_data();  // 阵型字符串 -> 数据
-    bool lineup_code_to_data();    // 阵型代码 -> 数据
-    void data_to_lineup_code();    // 数据 -> 阵型代码
-    inline void compress_data();   // 压缩数组
-    inline void decompress_data(); // 解压数组
+    bool lineup_string_to_data(); // 阵型字符串 -> 数据
+    bool lineup_code_to_data();   // 阵型代码 -> 数据
+    void data_to_lineup_code();   // 数据 -> 阵型代码
 };
 
 } // namespace Pt
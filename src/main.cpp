@@ -43,6 +43,22 @@ void window_callback(Fl_Widget *w, void *)
     ((Pt::Toolkit *)w)->hide();
 }
 
+// 发布版链接为窗口程序 (/SUBSYSTEM:WINDOWS), 没有自己的控制台
+// 命令行模式下连接到启动它的控制台输出, 输出已经重定向到文件或者管道时不变
+void attach_parent_console()
+{
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (out != nullptr && out != INVALID_HANDLE_VALUE && GetFileType(out) != FILE_TYPE_UNKNOWN)
+        return;
+
+    if (AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        FILE *fp = nullptr;
+        freopen_s(&fp, "CONOUT$", "w", stdout);
+        freopen_s(&fp, "CONOUT$", "w", stderr);
+    }
+}
+
 void callback_pvz_check(void *w)
 {
     // 定期检查游戏进程状态
@@ -74,8 +90,37 @@ int main(int argc, char **argv)
     if (argc == 0)
         return -0;
 
+    // 列出 pak 里的文件: /L <pak>
+    // 解包单个文件: /X <pak> <pak 里的路径> [解包文件夹]
+    if ((argc == 3 && std::string(argv[1]) == "/L") //
+        || ((argc == 4 || argc == 5) && std::string(argv[1]) == "/X"))
+    {
+        attach_parent_console();
+
+        std::string file = argv[2];
+        Pt::PakArchive archive;
+        int ret = archive.Open(std::filesystem::path(std::u8string(file.begin(), file.end())));
+        if (ret != UNPACK_SUCCESS)
+            return ret;
+
+        if (argc == 3)
+        {
+            for (size_t i = 0; i < archive.Count(); i++)
+                printf("%10u  %s\n", archive.Entry(i).size, archive.Entry(i).name.c_str());
+            return UNPACK_SUCCESS;
+        }
+
+        int i = archive.Find(argv[3]);
+        if (i < 0)
+            return UNPACK_ENTRY_NOT_FOUND;
+        std::string dir = (argc == 5) ? argv[4] : ".";
+        return archive.Extract(i, std::filesystem::path(std::u8string(dir.begin(), dir.end())));
+    }
+
     if (argc == 4)
     {
+        attach_parent_console();
+
         std::string m = argv[1];
         std::string file = argv[2];
         std::string dir = argv[3];
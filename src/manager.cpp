@@ -0,0 +1,129 @@
+
+#include "manager.h"
+
+namespace Pt
+{
+
+ProcessManager::ProcessManager()
+{
+}
+
+ProcessManager::~ProcessManager()
+{
+    Clear();
+}
+
+size_t ProcessManager::FindAll()
+{
+    Clear();
+
+    for (HWND hwnd : PvZ::FindWindows())
+    {
+        auto instance = std::make_unique<Instance>();
+        instance->hwnd = hwnd;
+        instance->worker = std::thread(run, instance.get());
+        this->instances.push_back(std::move(instance));
+    }
+
+    // 每个实例在自己的线程上连接和识别版本
+    std::vector<std::future<bool>> found;
+    for (auto &instance : this->instances)
+    {
+        auto result = std::make_shared<std::promise<bool>>();
+        found.push_back(result->get_future());
+        Instance *p = instance.get();
+        post(p, [p, result]()
+             { result->set_value(p->pvz.FindPvZ(p->hwnd)); });
+    }
+
+    // 去掉不是游戏或者不支持的窗口
+    std::vector<std::unique_ptr<Instance>> supported;
+    for (size_t i = 0; i < this->instances.size(); i++)
+    {
+        if (found[i].get())
+        {
+            supported.push_back(std::move(this->instances[i]));
+        }
+        else
+        {
+            auto &instance = this->instances[i];
+            {
+                std::lock_guard<std::mutex> lock(instance->mutex);
+                instance->stop = true;
+            }
+            instance->cv.notify_one();
+            instance->worker.join();
+        }
+    }
+    this->instances = std::move(supported);
+
+#ifdef _DEBUG
+    std::wcout << L"找到游戏实例: " << this->instances.size() << std::endl;
+#endif
+
+    return this->instances.size();
+}
+
+size_t ProcessManager::Count()
+{
+    return this->instances.size();
+}
+
+void ProcessManager::Broadcast(std::function<void(PvZ &)> func)
+{
+    for (auto &instance : this->instances)
+    {
+        Instance *p = instance.get();
+        post(p, [p, func]()
+             { func(p->pvz); });
+    }
+}
+
+void ProcessManager::run(Instance *instance)
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(instance->mutex);
+            instance->cv.wait(lock, [instance]()
+                              { return instance->stop || !instance->tasks.empty(); });
+            if (instance->tasks.empty()) // stop
+                return;
+            task = std::move(instance->tasks.front());
+            instance->tasks.pop_front();
+        }
+        task();
+    }
+}
+
+std::future<void> ProcessManager::post(Instance *instance, std::function<void()> func)
+{
+    auto task = std::make_shared<std::packaged_task<void()>>(func);
+    std::future<void> result = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(instance->mutex);
+        instance->tasks.push_back([task]()
+                                  { (*task)(); });
+    }
+    instance->cv.notify_one();
+    return result;
+}
+
+void ProcessManager::Clear()
+{
+    for (auto &instance : this->instances)
+    {
+        {
+            std::lock_guard<std::mutex> lock(instance->mutex);
+            instance->stop = true;
+        }
+        instance->cv.notify_one();
+    }
+    for (auto &instance : this->instances)
+        if (instance->worker.joinable())
+            instance->worker.join();
+    this->instances.clear();
+}
+
+} // namespace Pt
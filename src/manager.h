@@ -0,0 +1,63 @@
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+
+#include <Windows.h>
+
+#include "pvz.h"
+
+namespace Pt
+{
+
+// 同时管理多个游戏实例
+// 每个实例有自己的 PvZ 对象 (包括汇编缓冲和远程代码内存) 和工作线程
+class ProcessManager
+{
+  public:
+    ProcessManager();
+    ~ProcessManager();
+
+    // 查找并连接所有游戏实例, 返回支持的实例数
+    size_t FindAll();
+
+    // 已连接的实例数
+    size_t Count();
+
+    // 把同一个操作交给所有实例的工作线程并行执行, 不等待完成, 界面线程不会被卡住
+    // 同一个实例上的操作按提交的顺序执行, 参数需要按值捕获
+    void Broadcast(std::function<void(PvZ &)>);
+
+    // 执行完已经提交的操作之后停止并回收所有实例
+    void Clear();
+
+  private:
+    struct Instance
+    {
+        HWND hwnd;
+        PvZ pvz;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> tasks;
+        bool stop = false;
+    };
+
+    std::vector<std::unique_ptr<Instance>> instances;
+
+    // 工作线程循环执行任务队列
+    static void run(Instance *);
+
+    // 添加任务到实例的队列
+    std::future<void> post(Instance *, std::function<void()>);
+};
+
+} // namespace Pt
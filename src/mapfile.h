@@ -0,0 +1,41 @@
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+
+namespace Pt
+{
+
+// 只读内存映射文件, Windows 用 CreateFileMapping, 其他平台用 mmap
+class MappedFile
+{
+  public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool Open(const std::filesystem::path &);
+    void Close();
+
+    bool IsOpen() const;
+    const uint8_t *Data() const;
+    size_t Size() const;
+
+  private:
+    const uint8_t *data;
+    size_t size;
+    bool opened;
+
+#ifdef _WIN32
+    void *file;    // HANDLE
+    void *mapping; // HANDLE
+#else
+    int fd;
+#endif
+};
+
+} // namespace Pt
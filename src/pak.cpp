@@ -1,5 +1,16 @@
 
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <system_error>
+#include <map>
+#include <unordered_set>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
 #include "pak.h"
+#include "simd.h"
 
 namespace Pt
 {
@@ -12,6 +23,93 @@ PAK::~PAK()
 {
 }
 
+// pak 文件的加密方式为每个字节异或 0xF7
+
+static void xor_copy_scalar(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        dst[i] = src[i] ^ 0xf7;
+}
+
+#if defined(PTK_SIMD_X86)
+
+PTK_TARGET_SSE2
+static void xor_copy_sse2(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    const __m128i k = _mm_set1_epi8((char)0xf7);
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(src + i + 48));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a, k));
+        _mm_storeu_si128((__m128i *)(dst + i + 16), _mm_xor_si128(b, k));
+        _mm_storeu_si128((__m128i *)(dst + i + 32), _mm_xor_si128(c, k));
+        _mm_storeu_si128((__m128i *)(dst + i + 48), _mm_xor_si128(d, k));
+    }
+    for (; i + 16 <= size; i += 16)
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), k));
+    xor_copy_scalar(dst + i, src + i, size - i);
+}
+
+PTK_TARGET_AVX2
+static void xor_copy_avx2(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    const __m256i k = _mm256_set1_epi8((char)0xf7);
+    size_t i = 0;
+    for (; i + 128 <= size; i += 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + i + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(src + i + 96));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(a, k));
+        _mm256_storeu_si256((__m256i *)(dst + i + 32), _mm256_xor_si256(b, k));
+        _mm256_storeu_si256((__m256i *)(dst + i + 64), _mm256_xor_si256(c, k));
+        _mm256_storeu_si256((__m256i *)(dst + i + 96), _mm256_xor_si256(d, k));
+    }
+    for (; i + 32 <= size; i += 32)
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(src + i)), k));
+    xor_copy_scalar(dst + i, src + i, size - i);
+}
+
+#endif
+
+// 异或 0xF7 的同时复制, dst 和 src 可以相同, 按 CPU 支持的指令集选择实现
+static void xor_copy(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    using XorCopy = void (*)(uint8_t *, const uint8_t *, size_t);
+    static const XorCopy impl = []() -> XorCopy
+    {
+#if defined(PTK_SIMD_X86)
+        if (CpuHasAVX2())
+            return xor_copy_avx2;
+        if (CpuHasSSE2())
+            return xor_copy_sse2;
+#endif
+        return xor_copy_scalar;
+    }();
+    impl(dst, src, size);
+}
+
+// FILETIME 为 1601 年起的 100 纳秒数, MSVC 的 file_clock 与它相同, 其他平台经过系统时间转换
+static std::filesystem::file_time_type filetime_to_file_time(uint64_t time)
+{
+#if defined(_MSC_VER)
+    return std::filesystem::file_time_type(std::filesystem::file_time_type::duration(time));
+#else
+    const int64_t unix_epoch = 116444736000000000; // 1970 年对应的 FILETIME
+    auto since_epoch = std::chrono::nanoseconds(((int64_t)time - unix_epoch) * 100);
+    auto sys_time = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(since_epoch));
+    return std::chrono::file_clock::from_sys(sys_time);
+#endif
+}
+
+#ifdef _WIN32
+
 std::string PAK::utf8_encode(const std::wstring &wstr)
 {
     if (wstr.empty())
@@ -101,190 +199,267 @@ void PAK::find_files(const std::wstring find_path,
     }
 }
 
-int PAK::Unpack(std::wstring src_file, std::wstring dst_dir)
-{
-#ifdef _DEBUG
-    std::wcout << L"解包源文件: " << src_file << std::endl;
-    std::wcout << L"解包目标文件夹: " << dst_dir << std::endl;
 #endif
 
-    // 打开 pak 文件
-    HANDLE hfr = CreateFileW(src_file.c_str(), GENERIC_READ, FILE_SHARE_READ, //
-                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (hfr == INVALID_HANDLE_VALUE)
-        return UNPACK_SRC_NOT_EXIST;
-
-    // 获取大小
-    DWORD size = GetFileSize(hfr, nullptr);
-    if (size == INVALID_FILE_SIZE || size < 10)
-    {
-        CloseHandle(hfr);
-        return UNPACK_SRC_SIZE_ERROR;
-    }
-#ifdef _DEBUG
-    std::wcout << L"源文件大小: " << size << "字节" << std::endl;
-#endif
+int PAK::parse_index(const uint8_t *data, size_t size, std::vector<PAK_ENTRY> &entries)
+{
+    entries.clear();
 
-    // 将整个文件内容加载到内存里
-    char *buffer = new char[size];
-    DWORD read_size = 0;
-    BOOL ret = ReadFile(hfr, buffer, size, &read_size, nullptr);
-    CloseHandle(hfr);
+    // 文件偏移量
+    size_t offset = 0;
 
-    if (ret == FALSE || size != read_size)
+    // 从映射的数据里读出并解密
+    auto read = [&](void *dst, size_t n) -> bool
     {
-        delete[] buffer;
-        return UNPACK_SRC_LOAD_ERROR;
-    }
-
-    // 整个文件与 0xF7 异或
-    for (size_t i = 0; i < size; ++i)
-        buffer[i] = buffer[i] ^ 0xf7;
-
-    // 文件偏移量
-    unsigned int offset = 0;
+        if (n > size - offset)
+            return false;
+        xor_copy((uint8_t *)dst, data + offset, n);
+        offset += n;
+        return true;
+    };
 
     // 检查文件头
-    unsigned long file_header_magic = (unsigned long &)buffer[offset];
-    offset += sizeof(unsigned long);
-    unsigned long file_header_version = (unsigned long &)buffer[offset];
-    offset += sizeof(unsigned long);
+    uint32_t file_header_magic = 0;
+    uint32_t file_header_version = 0;
+    if (!read(&file_header_magic, sizeof(uint32_t)) || !read(&file_header_version, sizeof(uint32_t)))
+        return UNPACK_SRC_HEADER_ERROR;
     if (file_header_magic != 0xBAC04AC0 || file_header_version > 0x00000000)
-    {
-        delete[] buffer;
         return UNPACK_SRC_HEADER_ERROR;
-    }
 
     // 索引区域数据结构
-    unsigned char eof_flag;   // 结束标志
-    unsigned char name_width; // 文件名长度
-    char file_name[256];      // 文件名
-    int file_size;            // 大小
-    FILETIME file_time;       // 时间
-
-    unsigned int files_count = 0;        // 文件总数
-    std::vector<std::string> files_name; // pak 里保存的路径
-    std::vector<int> files_size;         // 大小
+    uint8_t eof_flag;    // 结束标志
+    uint8_t name_width;  // 文件名长度
+    char file_name[256]; // 文件名
+    uint32_t file_size;  // 大小
+    uint64_t file_time;  // 时间, FILETIME
 
     // 遍历索引区获取文件信息
     for (;;)
     {
-        eof_flag = (unsigned char &)buffer[offset];
-        offset += sizeof(unsigned char);
+        if (!read(&eof_flag, sizeof(uint8_t)))
+            return UNPACK_SRC_DATA_ERROR;
         // 遇到结束标志退出循环
-        if (eof_flag != static_cast<unsigned char>(0x00) || eof_flag == static_cast<unsigned char>(0x80))
+        if (eof_flag != 0x00)
             break;
 
-        name_width = (unsigned char &)buffer[offset];
-        offset += sizeof(unsigned char);
-
-        for (unsigned int i = 0; i < static_cast<unsigned int>(name_width); i++)
-            file_name[i] = buffer[offset + i];
-        file_name[static_cast<unsigned int>(name_width)] = 0;
-        offset += static_cast<unsigned int>(name_width);
-
-        file_size = (int &)buffer[offset];
-        offset += sizeof(int);
+        if (!read(&name_width, sizeof(uint8_t))        //
+            || !read(file_name, name_width)            //
+            || !read(&file_size, sizeof(uint32_t))     //
+            || !read(&file_time, sizeof(uint64_t)))
+            return UNPACK_SRC_DATA_ERROR;
 
-        file_time = (FILETIME &)buffer[offset]; // 没用
-        offset += sizeof(FILETIME);
-
-        files_name.push_back(std::string(file_name));
-        files_size.push_back(file_size);
-        files_count++;
+        entries.push_back({std::string(file_name, name_width), 0, file_size, file_time});
 
 #ifdef _DEBUG
-        SYSTEMTIME system_time;
-        FileTimeToSystemTime(&file_time, &system_time);
-        std::wcout << unsigned char(name_width) << " "
-                   << file_name << " "
+        std::wcout << unsigned(name_width) << " "
+                   << std::string(file_name, name_width).c_str() << " "
                    << file_size << " "
-                   << system_time.wYear << "."
-                   << system_time.wMonth << "."
-                   << system_time.wDay << " "
-                   << system_time.wHour << ":"
-                   << system_time.wMinute << ":"
-                   << system_time.wSecond << " "
-                   << unsigned char(eof_flag) << std::endl;
+                   << file_time << " "
+                   << unsigned(eof_flag) << std::endl;
 #endif
     }
 #ifdef _DEBUG
-    std::wcout << L"文件总数: " << files_count << std::endl;
+    std::wcout << L"文件总数: " << entries.size() << std::endl;
 #endif
 
-    // 检查文件索引区域数据的正确性
-    unsigned int _offset = offset; // 暂存
-    for (unsigned int i = 0; i < files_count; i++)
+    // 数据区按索引顺序紧接着索引区, 大小之和必须正好到文件末尾
+    for (auto &entry : entries)
     {
-        int output_file_size = files_size.at(i);
-        offset += output_file_size;
+        entry.offset = offset;
+        if (entry.size > size - offset)
+            return UNPACK_SRC_DATA_ERROR;
+        offset += entry.size;
     }
     if (offset != size)
-    {
-        delete[] buffer;
         return UNPACK_SRC_DATA_ERROR;
-    }
-    offset = _offset; // 还原
 
-    // 提取数据区所有文件
-    for (size_t i = 0; i < files_count; i++)
+    return UNPACK_SUCCESS;
+}
+
+bool PAK::entry_path(const std::filesystem::path &dst_dir, const std::string &entry_name,
+                     std::filesystem::path &output_path)
+{
+    // pak 里的路径用 \ 分隔
+    std::string name = entry_name;
+    std::replace(name.begin(), name.end(), '\\', '/');
+    std::filesystem::path relative(std::u8string(name.begin(), name.end()));
+
+    // dst_dir / 绝对路径 会丢掉 dst_dir, 这些文件名只可能来自损坏或者恶意的 pak
+    if (relative.empty() || relative.has_root_name() || relative.has_root_directory())
+        return false;
+    for (const auto &part : relative)
+        if (part == "..")
+            return false;
+
+    output_path = dst_dir / relative;
+    return true;
+}
+
+int PAK::extract_entry(const uint8_t *data, const PAK_ENTRY &entry, const std::filesystem::path &output_path,
+                       std::vector<uint8_t> &buffer)
+{
+    std::ofstream ofs(output_path, std::ios::binary | std::ios::trunc);
+    if (!ofs)
+        return UNPACK_FILE_CREATE_ERROR;
+
+    // 分块解密后直接写出
+    const uint8_t *src = data + entry.offset;
+    for (size_t done = 0; done < entry.size;)
     {
-        // 每个文件完整路径和大小
-        std::wstring output_path = dst_dir + L"\\" + utf8_decode(files_name.at(i));
-        unsigned int output_size = files_size.at(i);
+        size_t n = std::min<size_t>(buffer.size(), entry.size - done);
+        xor_copy(buffer.data(), src + done, n);
+        ofs.write((const char *)buffer.data(), n);
+        if (!ofs)
+            return UNPACK_FILE_WRITE_ERROR;
+        done += n;
+    }
+    ofs.close();
+    if (!ofs)
+        return UNPACK_FILE_WRITE_ERROR;
 
-        // 得到目录名并创建
-        bool path_created = create_path(output_path.substr(0, output_path.find_last_of(L"\\")));
-        if (!path_created)
-        {
-            // std::wcout << L"路径创建失败: " << output_path.substr(0, output_path.find_last_of(L"\\")) << std::endl;
-            delete[] buffer;
-            return UNPACK_PATH_CREATE_ERROR;
-        }
+    // 修改时间还原为 pak 里保存的时间, 之后增量打包时用来判断文件有没有被修改, 失败不影响解包
+    std::error_code ec;
+    std::filesystem::last_write_time(output_path, filetime_to_file_time(entry.time), ec);
+
+    return UNPACK_SUCCESS;
+}
 
-        HANDLE hfw = CreateFileW(output_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, //
-                                 nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-        if (hfw == INVALID_HANDLE_VALUE)
+int PAK::Unpack(const std::filesystem::path &src_file, const std::filesystem::path &dst_dir, unsigned int threads)
+{
+#ifdef _DEBUG
+    std::wcout << L"解包源文件: " << src_file.wstring() << std::endl;
+    std::wcout << L"解包目标文件夹: " << dst_dir.wstring() << std::endl;
+#endif
+
+    unpack_errors.clear();
+
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(src_file, ec))
+        return UNPACK_SRC_NOT_EXIST;
+
+    // 只读映射 pak 文件, 不再整个读进内存
+    MappedFile file;
+    if (!file.Open(src_file))
+        return UNPACK_SRC_LOAD_ERROR;
+
+    size_t size = file.Size();
+    if (size < 10)
+        return UNPACK_SRC_SIZE_ERROR;
+#ifdef _DEBUG
+    std::wcout << L"源文件大小: " << size << "字节" << std::endl;
+#endif
+
+    std::vector<PAK_ENTRY> entries;
+    int ret = parse_index(file.Data(), size, entries);
+    if (ret != UNPACK_SUCCESS)
+        return ret;
+
+    // 每个文件的结果, 先统一创建所有用到的目录, 每个目录只创建一次
+    std::vector<std::filesystem::path> output_paths(entries.size());
+    std::vector<int> results(entries.size(), UNPACK_SUCCESS);
+    std::map<std::filesystem::path, bool> dirs; // 目录 是否创建成功
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (!entry_path(dst_dir, entries[i].name, output_paths[i]))
         {
-            // std::wcout << L"文件创建失败: " << output_path << std::endl;
-            delete[] buffer;
-            return UNPACK_FILE_CREATE_ERROR;
+            results[i] = UNPACK_SRC_DATA_ERROR; // 文件名会写到解包目录外面
+            continue;
         }
+        dirs.emplace(output_paths[i].parent_path(), false);
+    }
+    for (auto &[dir, created] : dirs)
+    {
+        std::filesystem::create_directories(dir, ec);
+        created = !ec;
+    }
+    for (size_t i = 0; i < entries.size(); i++)
+        if (results[i] == UNPACK_SUCCESS && !dirs[output_paths[i].parent_path()])
+            results[i] = UNPACK_PATH_CREATE_ERROR;
+
+    // 写到同一个文件的 (重名, 或者只有大小写不同, 在 NTFS 上是同一个文件) 只解包最后一个
+    // 和原来按顺序解包时后写的覆盖先写的结果相同, 也避免两个线程同时写一个文件
+    std::vector<bool> superseded(entries.size(), false);
+    std::unordered_set<std::u8string> written;
+    for (size_t i = entries.size(); i-- > 0;)
+    {
+        if (results[i] != UNPACK_SUCCESS)
+            continue;
+        std::u8string key = output_paths[i].lexically_normal().generic_u8string();
+        for (auto &c : key)
+            if (c >= u8'A' && c <= u8'Z')
+                c = c - u8'A' + u8'a';
+        if (!written.insert(key).second)
+            superseded[i] = true;
+    }
 
-        char *output_buff = new char[output_size];
-        for (size_t j = 0; j < output_size; j++)
-            output_buff[j] = buffer[offset + j];
+    // 大文件先分出去, 最后剩下的都是小文件, 各个线程差不多同时结束
+    std::vector<size_t> order;
+    for (size_t i = 0; i < entries.size(); i++)
+        if (results[i] == UNPACK_SUCCESS && !superseded[i])
+            order.push_back(i);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return entries[a].size > entries[b].size; });
 
-        DWORD write_size = 0;
-        WriteFile(hfw, output_buff, output_size, &write_size, nullptr);
-        CloseHandle(hfw);
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned int)std::min<size_t>(threads, std::max<size_t>(order.size(), 1));
 
-        if (output_size != write_size)
+    std::atomic<size_t> next{0};
+    auto work = [&]()
+    {
+        std::vector<uint8_t> buffer(STREAM_BUFFER_SIZE);
+        size_t k;
+        while ((k = next.fetch_add(1)) < order.size())
         {
-            // std::wcout << L"文件写入失败: " << output_path << std::endl;
-            delete[] output_buff;
-            delete[] buffer;
-            return UNPACK_FILE_WRITE_ERROR;
+            size_t i = order[k];
+            results[i] = extract_entry(file.Data(), entries[i], output_paths[i], buffer);
         }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; i++)
+        workers.emplace_back(work);
+    work(); // 当前线程也干活
+    for (auto &t : workers)
+        t.join();
 
-        delete[] output_buff;
-        offset += output_size;
+    ret = UNPACK_SUCCESS;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (results[i] == UNPACK_SUCCESS)
+            continue;
+        unpack_errors.push_back({entries[i].name, results[i]});
+        if (ret == UNPACK_SUCCESS)
+            ret = results[i];
     }
+    return ret;
+}
 
-    delete[] buffer;
-    return UNPACK_SUCCESS;
+int PAK::Unpack(std::wstring src_file, std::wstring dst_dir)
+{
+    return Unpack(std::filesystem::path(src_file), std::filesystem::path(dst_dir));
+}
+
+const std::vector<PAK_FILE_ERROR> &PAK::UnpackErrors() const
+{
+    return unpack_errors;
 }
 
 int PAK::Unpack(std::string src_file, std::string dst_dir)
 {
-    return Unpack(utf8_decode(src_file), utf8_decode(dst_dir));
+    // utf8 路径
+    return Unpack(std::filesystem::path(std::u8string(src_file.begin(), src_file.end())),
+                  std::filesystem::path(std::u8string(dst_dir.begin(), dst_dir.end())));
 }
 
-int PAK::Pack(std::wstring src_dir, std::wstring dst_file)
+#ifdef _WIN32
+
+int PAK::Pack(std::wstring src_dir, std::wstring dst_file, std::wstring base_file)
 {
 #ifdef _DEBUG
     std::wcout << L"打包源文件夹: " << src_dir << std::endl;
     std::wcout << L"打包目标文件: " << dst_file << std::endl;
+    std::wcout << L"增量打包参考文件: " << base_file << std::endl;
 #endif
 
     DWORD fa = GetFileAttributesW(src_dir.c_str());
@@ -321,6 +496,29 @@ int PAK::Pack(std::wstring src_dir, std::wstring dst_file)
     }
 #endif
 
+    // 增量打包, 找出没有修改的文件在旧 pak 里的序号
+    // 旧 pak 就是输出文件时不能边读边写, 改为全部重新打包
+    PakArchive base;
+    std::vector<int> reuse(files_count, -1);
+    std::error_code ec;
+    if (!base_file.empty() && !std::filesystem::equivalent(base_file, dst_file, ec) //
+        && base.Open(std::filesystem::path(base_file)) == UNPACK_SUCCESS)
+    {
+        for (size_t i = 0; i < files_count; i++)
+        {
+            int j = base.Find(utf8_encode(files_name[i]));
+            if (j < 0)
+                continue;
+            uint64_t time = ((uint64_t)files_time[i].dwHighDateTime << 32) | files_time[i].dwLowDateTime;
+            if (base.Entry(j).size == (uint32_t)files_size[i] && base.Entry(j).time == time)
+                reuse[i] = j;
+        }
+#ifdef _DEBUG
+        std::wcout << L"沿用旧数据的文件数: " << std::count_if(reuse.begin(), reuse.end(), [](int j) { return j >= 0; })
+                   << std::endl;
+#endif
+    }
+
     // 创建输出文件夹
     bool path_created = create_path(dst_file.substr(0, dst_file.find_last_of(L"\\")));
     if (!path_created)
@@ -413,8 +611,7 @@ int PAK::Pack(std::wstring src_dir, std::wstring dst_file)
         assert(index == struct_size);
 
         // 加密
-        for (size_t k = 0; k < struct_size; k++)
-            buff[k] = buff[k] ^ 0xf7;
+        xor_copy((uint8_t *)buff, (const uint8_t *)buff, struct_size);
 
         // 写入缓冲
         WriteFile(hfw, buff, struct_size, &write_size, nullptr);
@@ -439,8 +636,24 @@ int PAK::Pack(std::wstring src_dir, std::wstring dst_file)
     }
 
     // 写数据区
+    std::vector<uint8_t> buffer(STREAM_BUFFER_SIZE);
     for (size_t i = 0; i < files_count; i++)
     {
+        // 没有修改的文件直接写入旧 pak 里已经加密的数据
+        if (reuse[i] >= 0)
+        {
+            const uint8_t *raw = base.Raw(reuse[i]);
+            DWORD size = base.Entry(reuse[i]).size;
+            DWORD write_size = 0;
+            WriteFile(hfw, raw, size, &write_size, nullptr);
+            if (write_size != size)
+            {
+                CloseHandle(hfw);
+                return PACK_FILE_WRITE_ERROR;
+            }
+            continue;
+        }
+
         // 完整文件路径
         auto file_path = src_dir + L"\\" + files_name.at(i);
 
@@ -452,43 +665,194 @@ int PAK::Pack(std::wstring src_dir, std::wstring dst_file)
             return PACK_SRC_READ_ERROR;
         }
 
-        // 读文件到缓冲
+        // 分块读取, 加密之后写入
         unsigned int size = files_size.at(i);
-        DWORD read_size = 0;
-        char *buffer = new char[size];
-        BOOL ret = ReadFile(hfr, buffer, size, &read_size, nullptr);
-        if (ret == FALSE || read_size != size)
+        for (unsigned int done = 0; done < size;)
         {
-            CloseHandle(hfw);
-            CloseHandle(hfr);
-            delete[] buffer;
-            return PACK_SRC_READ_ERROR;
-        }
-        CloseHandle(hfr);
+            DWORD n = (DWORD)std::min<size_t>(buffer.size(), size - done);
+            DWORD read_size = 0;
+            BOOL ret = ReadFile(hfr, buffer.data(), n, &read_size, nullptr);
+            if (ret == FALSE || read_size != n)
+            {
+                CloseHandle(hfw);
+                CloseHandle(hfr);
+                return PACK_SRC_READ_ERROR;
+            }
 
-        // 加密
-        for (size_t i = 0; i < size; ++i)
-            buffer[i] = buffer[i] ^ 0xf7;
+            xor_copy(buffer.data(), buffer.data(), n);
 
-        // 写入
-        DWORD write_size = 0;
-        WriteFile(hfw, buffer, size, &write_size, nullptr);
-        if (write_size != size)
-        {
-            CloseHandle(hfw);
-            delete[] buffer;
-            return PACK_FILE_WRITE_ERROR;
+            DWORD write_size = 0;
+            WriteFile(hfw, buffer.data(), n, &write_size, nullptr);
+            if (write_size != n)
+            {
+                CloseHandle(hfw);
+                CloseHandle(hfr);
+                return PACK_FILE_WRITE_ERROR;
+            }
+            done += n;
         }
-        delete[] buffer;
+        CloseHandle(hfr);
     }
 
     CloseHandle(hfw);
     return PACK_SUCCESS;
 }
 
-int PAK::Pack(std::string src_file, std::string dst_dir)
+int PAK::Pack(std::string src_file, std::string dst_dir, std::string base_file)
 {
-    return Pack(utf8_decode(src_file), utf8_decode(dst_dir));
+    return Pack(utf8_decode(src_file), utf8_decode(dst_dir), utf8_decode(base_file));
+}
+
+#endif
+
+PakArchive::PakArchive()
+{
+}
+
+PakArchive::~PakArchive()
+{
+    Close();
+}
+
+std::string PakArchive::normalize(std::string_view path)
+{
+    // 去掉开头的分隔符, 统一用 \ 分隔, ASCII 转小写
+    std::string s;
+    s.reserve(path.size());
+    for (char c : path)
+    {
+        if (c == '/')
+            c = '\\';
+        else if (c >= 'A' && c <= 'Z')
+            c = c - 'A' + 'a';
+        if (c == '\\' && s.empty())
+            continue;
+        s.push_back(c);
+    }
+    return s;
+}
+
+int PakArchive::Open(const std::filesystem::path &src_file)
+{
+    Close();
+
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(src_file, ec))
+        return UNPACK_SRC_NOT_EXIST;
+    if (!file.Open(src_file))
+        return UNPACK_SRC_LOAD_ERROR;
+    if (file.Size() < 10)
+    {
+        Close();
+        return UNPACK_SRC_SIZE_ERROR;
+    }
+
+    int ret = PAK::parse_index(file.Data(), file.Size(), entries);
+    if (ret != UNPACK_SUCCESS)
+    {
+        Close();
+        return ret;
+    }
+
+    // 同名的以后面的为准, 和解包时后写的覆盖先写的一致
+    index.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+        index[normalize(entries[i].name)] = i;
+
+    return UNPACK_SUCCESS;
+}
+
+void PakArchive::Close()
+{
+    file.Close();
+    entries.clear();
+    index.clear();
+}
+
+bool PakArchive::IsOpen() const
+{
+    return file.IsOpen();
+}
+
+size_t PakArchive::Count() const
+{
+    return entries.size();
+}
+
+const PAK_ENTRY &PakArchive::Entry(size_t i) const
+{
+    return entries[i];
+}
+
+int PakArchive::Find(std::string_view path) const
+{
+    auto it = index.find(normalize(path));
+    return it == index.end() ? -1 : (int)it->second;
+}
+
+const uint8_t *PakArchive::Raw(size_t i) const
+{
+    return file.Data() + entries[i].offset;
+}
+
+bool PakArchive::Read(size_t i, uint64_t offset, void *dst, size_t size) const
+{
+    const PAK_ENTRY &entry = entries[i];
+    if (offset > entry.size || size > entry.size - offset)
+        return false;
+    xor_copy((uint8_t *)dst, file.Data() + entry.offset + offset, size);
+    return true;
+}
+
+std::vector<uint8_t> PakArchive::Read(size_t i) const
+{
+    std::vector<uint8_t> data(entries[i].size);
+    Read(i, 0, data.data(), data.size());
+    return data;
+}
+
+std::vector<std::string> PakArchive::List(std::string_view dir) const
+{
+    std::string prefix = normalize(dir);
+    if (!prefix.empty() && prefix.back() != '\\')
+        prefix.push_back('\\');
+
+    // 前缀相同的路径取下一级的名字, 用原来的大小写
+    std::map<std::string, std::string> names; // 规范化的名字 -> 显示的名字
+    for (const auto &entry : entries)
+    {
+        std::string key = normalize(entry.name);
+        if (key.compare(0, prefix.size(), prefix) != 0)
+            continue;
+
+        size_t begin = entry.name.size() - (key.size() - prefix.size());
+        size_t end = key.find('\\', prefix.size());
+        if (end == std::string::npos)
+            names.emplace(key.substr(prefix.size()), entry.name.substr(begin));
+        else
+            names.emplace(key.substr(prefix.size(), end - prefix.size() + 1),
+                          entry.name.substr(begin, end - prefix.size()) + "\\");
+    }
+
+    std::vector<std::string> result;
+    for (auto &[key, name] : names)
+        result.push_back(name);
+    return result;
+}
+
+int PakArchive::Extract(size_t i, const std::filesystem::path &dst_dir) const
+{
+    std::filesystem::path output_path;
+    if (!PAK::entry_path(dst_dir, entries[i].name, output_path))
+        return UNPACK_SRC_DATA_ERROR;
+
+    std::error_code ec;
+    std::filesystem::create_directories(output_path.parent_path(), ec);
+    if (ec)
+        return UNPACK_PATH_CREATE_ERROR;
+
+    std::vector<uint8_t> buffer(std::min<size_t>(PAK::STREAM_BUFFER_SIZE, std::max<size_t>(entries[i].size, 1)));
+    return PAK::extract_entry(file.Data(), entries[i], output_path, buffer);
 }
 
 } // namespace Pt
@@ -5,8 +5,16 @@
 #include <string>
 #include <vector>
 #include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
 
+#include "mapfile.h"
+
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 namespace Pt
 {
@@ -29,6 +37,24 @@ namespace Pt
 #define PACK_FILE_WRITE_ERROR 5  // 打包文件写入失败
 #define PACK_SRC_READ_ERROR 6    // 打包源文件读取失败
 
+#define UNPACK_ENTRY_NOT_FOUND 9 // pak 里没有这个文件
+
+// pak 索引里的一个文件
+struct PAK_ENTRY
+{
+    std::string name; // pak 里保存的路径, utf8, 用 \ 分隔
+    uint64_t offset;  // 数据在 pak 中的位置
+    uint32_t size;    // 大小
+    uint64_t time;    // 修改时间, FILETIME
+};
+
+// 解包失败的文件
+struct PAK_FILE_ERROR
+{
+    std::string name; // pak 里保存的路径
+    int error;        // 错误码
+};
+
 class PAK
 {
   public:
@@ -36,6 +62,24 @@ class PAK
     ~PAK();
 
   private:
+    friend class PakArchive;
+
+    // 解析已经映射的 pak 文件的索引区, 返回 UNPACK_SUCCESS 或者错误码
+    static int parse_index(const uint8_t *, size_t, std::vector<PAK_ENTRY> &);
+
+    // 解包时数据分块异或之后写入, 不用把整个文件读进内存
+    static constexpr size_t STREAM_BUFFER_SIZE = 256 * 1024;
+
+    // pak 里的路径转成解包后的文件路径
+    // 绝对路径, 带盘符或者含有 .. 的路径会写到解包目录外面, 返回 false
+    static bool entry_path(const std::filesystem::path &, const std::string &, std::filesystem::path &);
+
+    // 解包一个文件, 目录需要已经创建
+    static int extract_entry(const uint8_t *, const PAK_ENTRY &, const std::filesystem::path &, std::vector<uint8_t> &);
+
+    std::vector<PAK_FILE_ERROR> unpack_errors;
+
+#ifdef _WIN32
     std::string utf8_encode(const std::wstring &);
     std::wstring utf8_decode(const std::string &);
 
@@ -47,15 +91,69 @@ class PAK
                     std::vector<std::wstring> &, //
                     std::vector<int> &,          //
                     std::vector<FILETIME> &);
+#endif
 
   public:
     // 解包, 参数分别为源文件名和解包文件夹
+    // 映射源文件之后逐个文件流式写出, 可以在 Linux 上使用
+    // threads 为解包线程数, 0 为 CPU 核心数, 先统一创建目录再按文件大小从大到小分给各个线程
+    // 某个文件失败时其他文件继续解包, 返回按索引顺序第一个失败的错误码, 失败的文件见 UnpackErrors
+    int Unpack(const std::filesystem::path &, const std::filesystem::path &, unsigned int threads = 0);
     int Unpack(std::wstring, std::wstring);
     int Unpack(std::string, std::string);
 
+    // 上次解包失败的文件, 按索引顺序
+    const std::vector<PAK_FILE_ERROR> &UnpackErrors() const;
+
+#ifdef _WIN32
     // 打包, 参数分别为源文件夹和打包文件名
-    int Pack(std::wstring, std::wstring);
-    int Pack(std::string, std::string);
+    // 指定之前的 pak 文件时增量打包, 大小和修改时间都和旧索引相同的文件直接复制旧的加密数据, 不再读取源文件
+    int Pack(std::wstring, std::wstring, std::wstring base_file = L"");
+    int Pack(std::string, std::string, std::string base_file = "");
+#endif
+};
+
+// 随机读取 pak 里的单个文件, 不用全部解包
+// 映射整个 pak, 按路径建哈希索引, 读取时从映射里边复制边解密
+class PakArchive
+{
+  public:
+    PakArchive();
+    ~PakArchive();
+
+    PakArchive(const PakArchive &) = delete;
+    PakArchive &operator=(const PakArchive &) = delete;
+
+    // 返回 UNPACK_SUCCESS 或者 UNPACK_SRC_* 错误码
+    int Open(const std::filesystem::path &);
+    void Close();
+    bool IsOpen() const;
+
+    size_t Count() const;
+    const PAK_ENTRY &Entry(size_t) const;
+
+    // 按路径查找, 不区分大小写, / 和 \ 相同, 不存在返回 -1
+    int Find(std::string_view) const;
+
+    // 映射中加密的原始数据
+    const uint8_t *Raw(size_t) const;
+
+    // 解密第 i 个文件从 offset 开始的 size 个字节, 超出范围返回 false
+    bool Read(size_t, uint64_t, void *, size_t) const;
+    std::vector<uint8_t> Read(size_t) const;
+
+    // 列出目录下的文件和子目录, "" 为根目录, 子目录名以 \ 结尾, 按名字排序
+    std::vector<std::string> List(std::string_view) const;
+
+    // 解包单个文件到文件夹, 保留 pak 里的路径
+    int Extract(size_t, const std::filesystem::path &) const;
+
+  private:
+    MappedFile file;
+    std::vector<PAK_ENTRY> entries;
+    std::unordered_map<std::string, size_t> index; // 规范化的路径 -> 序号
+
+    static std::string normalize(std::string_view);
 };
 
 } // namespace Pt
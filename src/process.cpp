@@ -52,6 +52,67 @@ bool Process::OpenByWindow(const wchar_t *class_name, const wchar_t *window_name
     return this->hwnd != nullptr;
 }
 
+bool Process::OpenByWindow(HWND hwnd)
+{
+    if (IsValid())
+        CloseHandle(this->handle);
+
+    this->hwnd = hwnd;
+    this->pid = 0;
+    this->handle = nullptr;
+
+    if (this->hwnd != nullptr)
+    {
+        GetWindowThreadProcessId(this->hwnd, &(this->pid));
+        if (this->pid != 0)
+            this->handle = OpenProcess(PROCESS_ALL_ACCESS, false, this->pid);
+    }
+
+#ifdef _DEBUG
+    std::wcout << L"打开窗口: " << this->hwnd << L" " << this->pid << L" " << this->handle << std::endl;
+#endif
+
+    return this->hwnd != nullptr;
+}
+
+uint64_t Process::StartTime()
+{
+    if (this->handle == nullptr)
+        return 0;
+
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (GetProcessTimes(this->handle, &creation_time, &exit_time, &kernel_time, &user_time) == 0)
+        return 0;
+
+    return (uint64_t(creation_time.dwHighDateTime) << 32) | creation_time.dwLowDateTime;
+}
+
+bool Process::ReadMemoryBlock(void *buffer, size_t size, std::initializer_list<uintptr_t> addr)
+{
+    if (!IsValid())
+        return false;
+
+    uintptr_t offset = 0;
+    for (auto it = addr.begin(); it != addr.end(); it++)
+    {
+        unsigned long read_size = 0;
+        if (it != addr.end() - 1)
+        {
+            int ret = ReadProcessMemory(this->handle, (const void *)(offset + *it), &offset, sizeof(offset), &read_size);
+            if (ret == 0 || sizeof(offset) != read_size)
+                return false;
+        }
+        else
+        {
+            int ret = ReadProcessMemory(this->handle, (const void *)(offset + *it), buffer, size, &read_size);
+            if (ret == 0 || size != read_size)
+                return false;
+        }
+    }
+
+    return true;
+}
+
 bool Process::IsValid()
 {
     if (this->handle == nullptr)
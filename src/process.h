@@ -25,6 +25,12 @@ class Process
     // 根据窗口类名和标题打开进程
     bool OpenByWindow(const wchar_t *, const wchar_t *);
 
+    // 根据窗口句柄打开进程
+    bool OpenByWindow(HWND);
+
+    // 进程启动时间, 和 PID 一起唯一标识一个进程
+    uint64_t StartTime();
+
     // 进程可用性
     bool IsValid();
 
@@ -48,6 +54,9 @@ class Process
     template <typename T, size_t size>
     void WriteMemory(std::array<T, size>, std::initializer_list<uintptr_t>);
 
+    // 读一整块内存, 大小在运行时确定
+    bool ReadMemoryBlock(void *, size_t, std::initializer_list<uintptr_t>);
+
   protected:
     HWND hwnd;     // 窗口句柄
     DWORD pid;     // 进程标识
@@ -1,5 +1,7 @@
 
 #include "pvz.h"
+#include "library.h"
+#include "spawn.h"
 
 namespace Pt
 {
@@ -8,12 +10,18 @@ PvZ::PvZ()
 {
     this->cb_find_result = nullptr;
     this->window = nullptr;
+    this->pinned_hwnd = nullptr;
+
+    // 所有实例共用一份版本索引, 只在第一个实例创建时读注册表
+    std::call_once(version_index_once, load_version_index);
 
     // FindPvZ();
 }
 
 PvZ::~PvZ()
 {
+    if (IsValid())
+        asm_free_remote(this->handle);
 }
 
 void PvZ::asm_code_inject()
@@ -37,91 +45,16 @@ bool PvZ::FindPvZ()
 {
     this->find_result = PVZ_NOT_FOUND;
 
-    std::vector<std::wstring> pvz_titles = {
-        L"Bloom & Doom BETA 0.1.1.1014",          //
-        L"Plants vs. Zombies BETA 0.9.9.1029",    //
-        L"Plants vs. Zombies",                    //
-        L"Plants vs. Zombies 1.2.0.1073",         //
-        L"Plants vs. Zombies 1.2.0.1073 RELEASE", //
-        L"Plants vs. Zombies GOTY",               //
-        L"Pflanzen gegen Zombies 1.2.0.1093",     //
-        L"Plantas contra Zombis 1.2.0.1093",      //
-        L"Plantes contre Zombies 1.2.0.1093",     //
-        L"Piante contro zombi 1.2.0.1093",        //
-    };                                            //
-
-    for (size_t i = 0; i < pvz_titles.size() + 1; i++)
-    {
-        bool found = false;
-
-        // 优先查找已知标题, 兼顾其他改动了标题的版本
-        if (i != pvz_titles.size())
-            found = OpenByWindow(L"MainWindow", pvz_titles[i].c_str());
-        else
-            found = OpenByWindow(L"MainWindow", nullptr);
+    // 遍历所有 MainWindow 类的窗口, 不依赖标题, 兼顾改动了标题的版本
+    std::vector<HWND> windows;
+    if (this->pinned_hwnd != nullptr)
+        windows.push_back(this->pinned_hwnd);
+    else
+        windows = FindWindows();
 
-        // 注意分支完整
-        if (found)
-        {
-            if (IsValid())
-            {
-                auto nth = 0x00400000 + ReadMemory<uintptr_t>({0x00400000 + 0x3c});
-                auto lcd = 0x00400000 + ReadMemory<uintptr_t>({nth + 0xc8});
-                std::string pdb;
-                if (lcd != (0x00400000 + 0))
-                    pdb = ReadMemory<std::string>({lcd + ReadMemory<uintptr_t>({lcd}) + 0x18});
-                // std::cout << pdb << std::endl;
-                auto none = std::string::npos;
-                if (pdb.empty()                                                        //
-                    || (pdb.find(".pdb") == none)                                      //
-                    || (pdb.find("\\Lawn\\") == none && pdb.find("\\lawn\\") == none)) //
-                {
-                    // 找到的可能是其他宝开游戏
-                    this->find_result = PVZ_NOT_FOUND;
-                }
-                else
-                {
-                    this->find_result = PVZ_UNSUPPORTED;
-                }
-
-                // version detection key value
-                std::vector<std::tuple<unsigned int, int>> v = {
-                    {0x49359c21, PVZ_BETA_0_1_1_1014_EN},          //
-                    {0x499a6204, PVZ_BETA_0_9_9_1029_EN},          //
-                    {0x49ecf563, PVZ_1_0_0_1051_EN},               //
-                    {0x4a37d6af, PVZ_1_2_0_1065_EN},               //
-                    {0x4a5b7963, PVZ_1_0_4_7924_ES},               //
-                    {0x4c237519, PVZ_1_0_7_3556_ES},               //
-                    {0x4ce4c3d6, PVZ_1_0_7_3467_RU},               //
-                    {0x4c2e3453, PVZ_GOTY_1_2_0_1073_EN},          //
-                    {0x4d02b058, PVZ_GOTY_1_2_0_1096_EN},          //
-                    {0x4ca31baa, PVZ_GOTY_1_2_0_1093_DE_ES_FR_IT}, //
-                    {0x4c563de1, PVZ_GOTY_1_1_0_1056_ZH},          //
-                    {0x4cc8e5f8, PVZ_GOTY_1_1_0_1056_JA},          //
-                    {0x4fcd7be2, PVZ_GOTY_1_1_0_1056_ZH_2012_06},  //
-                    {0x5003d437, PVZ_GOTY_1_1_0_1056_ZH_2012_07},  //
-                };
-
-                auto time_compiled = ReadMemory<unsigned int>({nth + 0x08});
-                for (size_t j = 0; j < v.size(); j++)
-                {
-                    auto [time_date_stamp, version_name] = v[j];
-                    if (time_compiled == time_date_stamp)
-                    {
-                        this->find_result = version_name;
-                        break;
-                    }
-                }
-            }
-            else // 没权限拿不到进程句柄
-            {
-                this->find_result = PVZ_OPEN_ERROR;
-            }
-        }
-        else
-        {
-            this->find_result = PVZ_NOT_FOUND;
-        }
+    for (HWND hwnd : windows)
+    {
+        this->find_result = attach(hwnd);
 
         // 没有找到窗口/打开进程失败就继续找
         if (this->find_result == PVZ_NOT_FOUND || this->find_result == PVZ_OPEN_ERROR)
@@ -137,6 +70,8 @@ bool PvZ::FindPvZ()
 
     if (!supported)
     {
+        // 先释放之前在这个进程里分配的代码内存, 再关闭句柄
+        asm_free_remote(IsValid() ? this->handle : nullptr);
         if (IsValid())
             CloseHandle(this->handle);
         this->hwnd = nullptr;
@@ -155,6 +90,198 @@ bool PvZ::FindPvZ()
     return supported;
 }
 
+bool PvZ::FindPvZ(HWND hwnd)
+{
+    this->pinned_hwnd = hwnd;
+    return FindPvZ();
+}
+
+std::vector<HWND> PvZ::FindWindows()
+{
+    std::vector<HWND> windows;
+    HWND hwnd = nullptr;
+    while ((hwnd = FindWindowExW(nullptr, hwnd, L"MainWindow", nullptr)) != nullptr)
+        windows.push_back(hwnd);
+    return windows;
+}
+
+int PvZ::attach(HWND hwnd)
+{
+    // 换进程之前释放原进程里的代码内存
+    asm_free_remote(IsValid() ? this->handle : nullptr);
+
+    OpenByWindow(hwnd);
+
+    // 注意分支完整
+    if (IsValid())
+        return detect_version();
+    else // 没权限拿不到进程句柄
+        return PVZ_OPEN_ERROR;
+}
+
+int PvZ::detect_version()
+{
+    // 同一个进程重新连接时直接使用上次的结果, 不读内存
+    uint64_t start_time = StartTime();
+    {
+        std::lock_guard<std::mutex> lock(version_index_mutex);
+        for (auto &item : version_index)
+            if (item.revision == VERSION_TABLE_REVISION && item.pid == this->pid && item.start_time == start_time)
+                return item.find_result;
+    }
+
+    // 一次读出 PE 头所在的整页
+    const uintptr_t image_base = 0x00400000;
+    std::array<uint8_t, 0x1000> header;
+    if (!ReadMemoryBlock(header.data(), header.size(), {image_base}) //
+        || header[0] != 'M' || header[1] != 'Z')
+        return PVZ_NOT_FOUND;
+
+    auto nth = (uint32_t &)header[0x3c];
+    if (nth + 0xc8 + sizeof(uint32_t) > header.size())
+        return PVZ_NOT_FOUND;
+
+    // 模块哈希: 文件头/时间戳/校验和/节表都在这一页里
+    // 不对代码段取哈希, 因为代码段会被本工具和其他修改器改写
+    auto module_hash = static_cast<uint32_t>(crc32(0L, header.data(), header.size()));
+
+    auto remember = [&](int result)
+    {
+        std::lock_guard<std::mutex> lock(version_index_mutex);
+        if (version_index.size() >= 64)
+            version_index.erase(version_index.begin());
+        version_index.push_back({this->pid, module_hash, start_time, result, VERSION_TABLE_REVISION});
+        save_version_index();
+        return result;
+    };
+
+    // 同一个游戏文件已经识别过
+    bool known = false;
+    int known_result = PVZ_NOT_FOUND;
+    {
+        std::lock_guard<std::mutex> lock(version_index_mutex);
+        for (auto &item : version_index)
+            if (item.revision == VERSION_TABLE_REVISION && item.module_hash == module_hash)
+            {
+                known = true;
+                known_result = item.find_result;
+                break;
+            }
+    }
+    if (known)
+        return remember(known_result);
+
+    int result = PVZ_NOT_FOUND;
+
+    auto lcd = (uint32_t &)header[nth + 0xc8];
+    std::string pdb;
+    if (lcd != 0)
+    {
+        // 调试信息字符串一般紧跟在目录后面, 整块读出
+        std::array<char, 0x200> block;
+        if (ReadMemoryBlock(block.data(), block.size(), {image_base + lcd}))
+        {
+            auto pdb_offset = (uint32_t &)block[0] + 0x18;
+            if (pdb_offset < block.size())
+                pdb = std::string(&block[pdb_offset], strnlen(&block[pdb_offset], block.size() - pdb_offset));
+            if (pdb_offset >= block.size() || pdb_offset + pdb.size() == block.size())
+                pdb = ReadMemory<std::string>({image_base + lcd + pdb_offset});
+        }
+    }
+    // std::cout << pdb << std::endl;
+    auto none = std::string::npos;
+    if (pdb.empty()                                                        //
+        || (pdb.find(".pdb") == none)                                      //
+        || (pdb.find("\\Lawn\\") == none && pdb.find("\\lawn\\") == none)) //
+    {
+        // 找到的可能是其他宝开游戏
+        result = PVZ_NOT_FOUND;
+    }
+    else
+    {
+        result = PVZ_UNSUPPORTED;
+    }
+
+    // version detection key value
+    std::vector<std::tuple<unsigned int, int>> v = {
+        {0x49359c21, PVZ_BETA_0_1_1_1014_EN},          //
+        {0x499a6204, PVZ_BETA_0_9_9_1029_EN},          //
+        {0x49ecf563, PVZ_1_0_0_1051_EN},               //
+        {0x4a37d6af, PVZ_1_2_0_1065_EN},               //
+        {0x4a5b7963, PVZ_1_0_4_7924_ES},               //
+        {0x4c237519, PVZ_1_0_7_3556_ES},               //
+        {0x4ce4c3d6, PVZ_1_0_7_3467_RU},               //
+        {0x4c2e3453, PVZ_GOTY_1_2_0_1073_EN},          //
+        {0x4d02b058, PVZ_GOTY_1_2_0_1096_EN},          //
+        {0x4ca31baa, PVZ_GOTY_1_2_0_1093_DE_ES_FR_IT}, //
+        {0x4c563de1, PVZ_GOTY_1_1_0_1056_ZH},          //
+        {0x4cc8e5f8, PVZ_GOTY_1_1_0_1056_JA},          //
+        {0x4fcd7be2, PVZ_GOTY_1_1_0_1056_ZH_2012_06},  //
+        {0x5003d437, PVZ_GOTY_1_1_0_1056_ZH_2012_07},  //
+    };
+
+    auto time_compiled = (uint32_t &)header[nth + 0x08];
+    for (size_t j = 0; j < v.size(); j++)
+    {
+        auto [time_date_stamp, version_name] = v[j];
+        if (time_compiled == time_date_stamp)
+        {
+            result = version_name;
+            break;
+        }
+    }
+
+    return remember(result);
+}
+
+std::vector<VERSION_INDEX_ITEM> PvZ::version_index;
+std::mutex PvZ::version_index_mutex;
+std::once_flag PvZ::version_index_once;
+
+void PvZ::load_version_index()
+{
+    version_index.clear();
+
+    HKEY hKey;
+    DWORD ret = RegOpenKeyExW(HKEY_CURRENT_USER, L"Software\\Cube Studio\\PvZ Toolkit\\v1", //
+                              0, KEY_QUERY_VALUE, &hKey);
+    if (ret != ERROR_SUCCESS)
+        return;
+
+    DWORD dwType = REG_BINARY;
+    DWORD dwSize = 0;
+    DWORD status = RegQueryValueExW(hKey, L"VersionIndex", 0, &dwType, nullptr, &dwSize);
+    if (status == ERROR_SUCCESS && dwType == REG_BINARY && dwSize % sizeof(VERSION_INDEX_ITEM) == 0)
+    {
+        version_index.resize(dwSize / sizeof(VERSION_INDEX_ITEM));
+        status = RegQueryValueExW(hKey, L"VersionIndex", 0, &dwType, (LPBYTE)version_index.data(), &dwSize);
+        if (status != ERROR_SUCCESS)
+            version_index.clear();
+    }
+    RegCloseKey(hKey);
+
+    // 丢掉旧版本表留下的项, 下次保存时就不再写回
+    std::erase_if(version_index, [](const VERSION_INDEX_ITEM &item)
+                  { return item.revision != VERSION_TABLE_REVISION; });
+
+#ifdef _DEBUG
+    std::wcout << L"版本索引: " << version_index.size() << std::endl;
+#endif
+}
+
+void PvZ::save_version_index()
+{
+    HKEY hKey;
+    DWORD ret = RegCreateKeyExW(HKEY_CURRENT_USER, L"Software\\Cube Studio\\PvZ Toolkit\\v1", //
+                                0, nullptr, 0, KEY_WRITE, nullptr, &hKey, nullptr);
+    if (ret != ERROR_SUCCESS)
+        return;
+
+    RegSetValueExW(hKey, L"VersionIndex", 0, REG_BINARY, (const BYTE *)version_index.data(),
+                   DWORD(version_index.size() * sizeof(VERSION_INDEX_ITEM)));
+    RegCloseKey(hKey);
+}
+
 bool PvZ::GameOn()
 {
     bool on = this->find_result != PVZ_NOT_FOUND      //
@@ -1374,6 +1501,15 @@ void PvZ::SetLawnMowers(int option)
     }
 }
 
+void PvZ::asm_delete_plant(uintptr_t addr)
+{
+    if (isBETA())
+        asm_mov_exx(Reg::ECX, addr);
+    else
+        asm_push_dword(addr);
+    asm_call(data().call_delete_plant);
+}
+
 void PvZ::ClearAllPlants()
 {
     if (!GameOn())
@@ -1394,12 +1530,7 @@ void PvZ::ClearAllPlants()
         auto plant_squished = ReadMemory<bool>({plant_offset + data().plant_squished + plant_struct_size * i});
         if (!plant_dead && !plant_squished)
         {
-            uint32_t addr = plant_offset + plant_struct_size * i;
-            if (isBETA())
-                asm_mov_exx(Reg::ECX, addr);
-            else
-                asm_push_dword(addr);
-            asm_call(data().call_delete_plant);
+            asm_delete_plant(plant_offset + plant_struct_size * i);
         }
     }
     asm_ret();
@@ -1435,6 +1566,15 @@ void PvZ::KillAllZombies()
 // 10 蜗牛
 // 11 钉耙
 // 12 脑子
+void PvZ::asm_delete_grid_item(uintptr_t addr)
+{
+    if (isBETA())
+        asm_mov_exx(Reg::ECX, addr);
+    else
+        asm_mov_exx(Reg::ESI, addr);
+    asm_call(data().call_delete_grid_item);
+}
+
 void PvZ::ClearGridItems(std::vector<int> types)
 {
     if (!GameOn())
@@ -1457,12 +1597,7 @@ void PvZ::ClearGridItems(std::vector<int> types)
         auto grid_item_type = ReadMemory<int>({grid_item_offset + data().grid_item_type + grid_item_struct_size * i});
         if (!grid_item_dead && std::find(types.begin(), types.end(), grid_item_type) != types.end())
         {
-            int addr = grid_item_offset + grid_item_struct_size * i;
-            if (isBETA())
-                asm_mov_exx(Reg::ECX, addr);
-            else
-                asm_mov_exx(Reg::ESI, addr);
-            asm_call(data().call_delete_grid_item);
+            asm_delete_grid_item(grid_item_offset + grid_item_struct_size * i);
         }
     }
     asm_ret();
@@ -1886,24 +2021,24 @@ Lineup PvZ::GetLineup()
             auto plant_imitater = ReadMemory<int>({plant_offset + data().plant_imitater + plant_struct_size * i}) == 48;
             if (plant_type == 16 || plant_type == 33) // 睡莲 花盆
             {
-                lineup.base[plant_row * 9 + plant_col] = (plant_type == 16) ? 1 : 2;
-                lineup.base_im[plant_row * 9 + plant_col] = plant_imitater ? 1 : 0;
+                lineup.base()[plant_row * 9 + plant_col] = (plant_type == 16) ? 1 : 2;
+                lineup.base_im()[plant_row * 9 + plant_col] = plant_imitater ? 1 : 0;
             }
             else if (plant_type == 30) // 南瓜
             {
-                lineup.pumpkin[plant_row * 9 + plant_col] = 1;
-                lineup.pumpkin_im[plant_row * 9 + plant_col] = plant_imitater ? 1 : 0;
+                lineup.pumpkin()[plant_row * 9 + plant_col] = 1;
+                lineup.pumpkin_im()[plant_row * 9 + plant_col] = plant_imitater ? 1 : 0;
             }
             else if (plant_type == 35) // 咖啡
             {
-                lineup.coffee[plant_row * 9 + plant_col] = 1;
-                lineup.coffee_im[plant_row * 9 + plant_col] = plant_imitater ? 1 : 0;
+                lineup.coffee()[plant_row * 9 + plant_col] = 1;
+                lineup.coffee_im()[plant_row * 9 + plant_col] = plant_imitater ? 1 : 0;
             }
             else // 主要植物
             {
-                lineup.plant[plant_row * 9 + plant_col] = plant_type + 1;
-                lineup.plant_im[plant_row * 9 + plant_col] = plant_imitater ? 1 : 0;
-                lineup.plant_awake[plant_row * 9 + plant_col] = plant_asleep ? 0 : 1;
+                lineup.plant()[plant_row * 9 + plant_col] = plant_type + 1;
+                lineup.plant_im()[plant_row * 9 + plant_col] = plant_imitater ? 1 : 0;
+                lineup.plant_awake()[plant_row * 9 + plant_col] = plant_asleep ? 0 : 1;
             }
         }
     }
@@ -1920,12 +2055,12 @@ Lineup PvZ::GetLineup()
             auto grid_item_col = ReadMemory<uint32_t>({grid_item_offset + data().grid_item_col + grid_item_struct_size * i});
             if (grid_item_type == 1) // 墓碑
             {
-                lineup.base[grid_item_row * 9 + grid_item_col] = 3;
-                lineup.base_im[grid_item_row * 9 + grid_item_col] = 0;
+                lineup.base()[grid_item_row * 9 + grid_item_col] = 3;
+                lineup.base_im()[grid_item_row * 9 + grid_item_col] = 0;
             }
             else if (grid_item_type == 3) // 梯子
             {
-                lineup.ladder[grid_item_row * 9 + grid_item_col] = 1;
+                lineup.ladder()[grid_item_row * 9 + grid_item_col] = 1;
             }
             else // 钉耙
             {
@@ -1937,7 +2072,279 @@ Lineup PvZ::GetLineup()
     return lineup;
 }
 
-void PvZ::SetLineup(Lineup lineup)
+void PvZ::asm_put_lineup_plant(int row, int col, int type, bool imitater, bool asleep, int scene, bool iz_style)
+{
+    if (type < 0 || type > 47       //
+        || type == 16 || type == 33 //
+        || type == 30 || type == 35)
+        return;
+
+    asm_put_plant(row, col, type, imitater, iz_style);
+
+    // 蘑菇类植物唤醒
+    if ((scene == 0 || scene == 2 || scene == 4) //
+        && Lineup::may_sleep[type] && !asleep)
+    {
+        asm_push_exx(Reg::EAX);
+        if (isGOTY())
+            asm_mov_exx_exx(Reg::EDI, Reg::EAX);
+        else if (isBETA())
+            asm_mov_exx_exx(Reg::ECX, Reg::EAX);
+        asm_push_byte(0);
+        asm_call(data().call_set_plant_sleeping);
+        asm_pop_exx(Reg::EAX);
+    }
+
+    // 土豆雷和阳光菇长大
+    // mov [eax+54],00000001
+    if (type == 4 || type == 9)
+    {
+        if (isBETA())
+            asm_add_list(0xc7, 0x40, 0x5c);
+        else
+            asm_add_list(0xc7, 0x40, 0x54);
+        asm_add_dword(1);
+    }
+}
+
+template <typename T>
+static inline T read_field(const std::vector<uint8_t> &block, size_t offset)
+{
+    T value;
+    memcpy(&value, block.data() + offset, sizeof(T));
+    return value;
+}
+
+bool PvZ::set_lineup_diff(const Lineup &lineup, bool is_iz)
+{
+    unsigned int plant_struct_size = 0x14c;
+    unsigned int grid_item_struct_size = 0xec;
+    if (this->find_result == PVZ_BETA_0_1_1_1014_EN)
+        grid_item_struct_size = 0x8c;
+
+    // 一次读完植物和场地物品数组
+    auto plant_count_max = ReadMemory<uint32_t>({data().lawn, data().board, data().plant_count_max});
+    auto plant_offset = ReadMemory<uintptr_t>({data().lawn, data().board, data().plant});
+    auto grid_item_count_max = ReadMemory<uint32_t>({data().lawn, data().board, data().grid_item_count_max});
+    auto grid_item_offset = ReadMemory<uintptr_t>({data().lawn, data().board, data().grid_item});
+
+    std::vector<uint8_t> plants(size_t(plant_count_max) * plant_struct_size);
+    std::vector<uint8_t> grid_items(size_t(grid_item_count_max) * grid_item_struct_size);
+    if (!plants.empty() && !ReadMemoryBlock(plants.data(), plants.size(), {plant_offset}))
+        return false;
+    if (!grid_items.empty() && !ReadMemoryBlock(grid_items.data(), grid_items.size(), {grid_item_offset}))
+        return false;
+
+    // 每格每层的对象地址, 同一格同一层多出来的对象和场地外的对象直接删除
+    enum
+    {
+        LAYER_BASE,
+        LAYER_PLANT,
+        LAYER_PUMPKIN,
+        LAYER_COFFEE,
+        LAYER_GRAVE,
+        LAYER_LADDER,
+        LAYER_COUNT,
+    };
+    uintptr_t addr[LAYER_COUNT][GRID] = {0};
+    std::vector<uintptr_t> delete_plants;
+    std::vector<uintptr_t> delete_grid_items;
+
+    int row_count = (lineup.scene == 2 || lineup.scene == 3) ? 6 : 5;
+
+    LineupData current;
+    memset(current.items, 0, sizeof(current.items));
+    current.scene = lineup.scene;
+    current.rake_row = 0;
+
+    for (size_t i = 0; i < plant_count_max; i++)
+    {
+        size_t base = plant_struct_size * i;
+        auto plant_dead = read_field<bool>(plants, base + data().plant_dead);
+        auto plant_squished = read_field<bool>(plants, base + data().plant_squished);
+        if (plant_dead || plant_squished)
+            continue;
+
+        uintptr_t plant_addr = plant_offset + base;
+        auto plant_type = read_field<uint32_t>(plants, base + data().plant_type);
+        auto plant_row = read_field<uint32_t>(plants, base + data().plant_row);
+        auto plant_col = read_field<uint32_t>(plants, base + data().plant_col);
+        if (plant_type > 47 || plant_row >= (uint32_t)row_count || plant_col >= 9)
+        {
+            delete_plants.push_back(plant_addr);
+            continue;
+        }
+
+        size_t cell = plant_row * 9 + plant_col;
+        auto plant_asleep = read_field<bool>(plants, base + data().plant_asleep);
+        auto plant_imitater = read_field<int>(plants, base + data().plant_imitater) == 48;
+
+        int layer = LAYER_PLANT;
+        if (plant_type == 16 || plant_type == 33) // 睡莲 花盆
+            layer = LAYER_BASE;
+        else if (plant_type == 30) // 南瓜
+            layer = LAYER_PUMPKIN;
+        else if (plant_type == 35) // 咖啡
+            layer = LAYER_COFFEE;
+
+        if (addr[layer][cell] != 0)
+        {
+            delete_plants.push_back(plant_addr);
+            continue;
+        }
+        addr[layer][cell] = plant_addr;
+
+        if (layer == LAYER_BASE)
+        {
+            current.base()[cell] = (plant_type == 16) ? 1 : 2;
+            current.base_im()[cell] = plant_imitater ? 1 : 0;
+        }
+        else if (layer == LAYER_PUMPKIN)
+        {
+            current.pumpkin()[cell] = 1;
+            current.pumpkin_im()[cell] = plant_imitater ? 1 : 0;
+        }
+        else if (layer == LAYER_COFFEE)
+        {
+            current.coffee()[cell] = 1;
+            current.coffee_im()[cell] = plant_imitater ? 1 : 0;
+        }
+        else
+        {
+            current.plant()[cell] = plant_type + 1;
+            current.plant_im()[cell] = plant_imitater ? 1 : 0;
+            current.plant_awake()[cell] = plant_asleep ? 0 : 1;
+        }
+    }
+
+    std::vector<uintptr_t> rakes;
+    for (size_t i = 0; i < grid_item_count_max; i++)
+    {
+        size_t base = grid_item_struct_size * i;
+        auto grid_item_dead = read_field<bool>(grid_items, base + data().grid_item_dead);
+        auto grid_item_type = read_field<int>(grid_items, base + data().grid_item_type);
+        if (grid_item_dead || (grid_item_type != 1 && grid_item_type != 2 && grid_item_type != 3 && grid_item_type != 11))
+            continue;
+
+        uintptr_t grid_item_addr = grid_item_offset + base;
+        auto grid_item_row = read_field<uint32_t>(grid_items, base + data().grid_item_row);
+        auto grid_item_col = read_field<uint32_t>(grid_items, base + data().grid_item_col);
+
+        if (grid_item_type == 11) // 钉耙
+        {
+            rakes.push_back(grid_item_addr);
+            current.rake_row = grid_item_row + 1;
+            continue;
+        }
+
+        if (grid_item_type == 2 || grid_item_row >= (uint32_t)row_count || grid_item_col >= 9) // 弹坑
+        {
+            delete_grid_items.push_back(grid_item_addr);
+            continue;
+        }
+
+        size_t cell = grid_item_row * 9 + grid_item_col;
+        int layer = (grid_item_type == 1) ? LAYER_GRAVE : LAYER_LADDER;
+        if (addr[layer][cell] != 0)
+            delete_grid_items.push_back(grid_item_addr);
+        else
+            addr[layer][cell] = grid_item_addr;
+    }
+
+    // 规范化之后按层比较, 不影响布阵结果的位不算差异
+    LineupData from = CanonicalLineup(current);
+    LineupData to = CanonicalLineup(lineup);
+
+    bool put[LAYER_COUNT][GRID] = {false};
+    for (size_t i = 0; i < GRID; i++)
+    {
+        bool from_pot = from.base()[i] == 1 || from.base()[i] == 2;
+        bool to_pot = to.base()[i] == 1 || to.base()[i] == 2;
+        bool base_diff = (from_pot ? from.base()[i] : 0) != (to_pot ? to.base()[i] : 0) //
+                         || (to_pot && from.base_im()[i] != to.base_im()[i]);
+        bool plant_diff = from.plant()[i] != to.plant()[i]              //
+                          || from.plant_im()[i] != to.plant_im()[i]     //
+                          || from.plant_awake()[i] != to.plant_awake()[i];
+        bool pumpkin_diff = from.pumpkin()[i] != to.pumpkin()[i] || from.pumpkin_im()[i] != to.pumpkin_im()[i];
+        bool coffee_diff = from.coffee()[i] != to.coffee()[i] || from.coffee_im()[i] != to.coffee_im()[i];
+
+        // 底座变了整格重来, 主要植物变了咖啡豆也要重新放
+        if (base_diff)
+            plant_diff = pumpkin_diff = coffee_diff = true;
+        if (plant_diff)
+            coffee_diff = true;
+
+        bool diff[LAYER_COUNT] = {base_diff, plant_diff, pumpkin_diff, coffee_diff,         //
+                                  (addr[LAYER_GRAVE][i] != 0) != (to.base()[i] == 3),   //
+                                  (addr[LAYER_LADDER][i] != 0) != (to.ladder()[i] == 1)}; //
+        bool want[LAYER_COUNT] = {to_pot, to.plant()[i] != 0, to.pumpkin()[i] == 1, to.coffee()[i] == 1, //
+                                  to.base()[i] == 3, to.ladder()[i] == 1};
+
+        for (int layer = 0; layer < LAYER_COUNT; layer++)
+        {
+            if (!diff[layer])
+                continue;
+            if (addr[layer][i] != 0)
+            {
+                if (layer == LAYER_GRAVE || layer == LAYER_LADDER)
+                    delete_grid_items.push_back(addr[layer][i]);
+                else
+                    delete_plants.push_back(addr[layer][i]);
+            }
+            put[layer][i] = want[layer];
+        }
+    }
+
+    bool rake_diff = !(rakes.size() == (to.rake_row != 0 ? 1 : 0) && current.rake_row == to.rake_row);
+    if (rake_diff)
+        delete_grid_items.insert(delete_grid_items.end(), rakes.begin(), rakes.end());
+
+#ifdef _DEBUG
+    size_t put_count = 0;
+    for (int layer = 0; layer < LAYER_COUNT; layer++)
+        for (size_t i = 0; i < GRID; i++)
+            put_count += put[layer][i] ? 1 : 0;
+    std::wcout << L"布阵差异: 删除 " << (delete_plants.size() + delete_grid_items.size()) //
+               << L" 放置 " << put_count << std::endl;
+#endif
+
+    // 先删后放, 放置顺序和完整布阵一致
+    asm_init();
+    for (uintptr_t a : delete_plants)
+        asm_delete_plant(a);
+    for (uintptr_t a : delete_grid_items)
+        asm_delete_grid_item(a);
+    for (int i = 0; i < GRID; i++)
+        if (put[LAYER_BASE][i])
+            asm_put_plant(i / 9, i % 9, to.base()[i] == 1 ? 16 : 33, to.base_im()[i] == 1, is_iz);
+    for (int i = 0; i < GRID; i++)
+        if (put[LAYER_PLANT][i])
+            asm_put_lineup_plant(i / 9, i % 9, to.plant()[i] - 1, to.plant_im()[i] == 1, //
+                                 to.plant_awake()[i] == 0, to.scene, is_iz);
+    for (int i = 0; i < GRID; i++)
+        if (put[LAYER_PUMPKIN][i])
+            asm_put_plant(i / 9, i % 9, 30, to.pumpkin_im()[i] == 1, is_iz);
+    for (int i = 0; i < GRID; i++)
+        if (put[LAYER_COFFEE][i])
+            asm_put_plant(i / 9, i % 9, 35, to.coffee_im()[i] == 1, is_iz);
+    for (int i = 0; i < GRID; i++)
+        if (put[LAYER_GRAVE][i])
+            asm_put_grave(i / 9, i % 9);
+    for (int i = 0; i < GRID; i++)
+        if (put[LAYER_LADDER][i])
+            asm_put_ladder(i / 9, i % 9);
+    asm_ret();
+    asm_code_inject();
+
+    // 钉耙需要临时改代码, 只能单独放
+    if (rake_diff && to.rake_row != 0)
+        PutRake(to.rake_row - 1, 8 - 1);
+
+    Sleep(GetFrameDuration());
+    return true;
+}
+
+void PvZ::SetLineup(Lineup lineup, bool diff)
 {
     if (!lineup.OK())
         return;
@@ -1954,6 +2361,10 @@ void PvZ::SetLineup(Lineup lineup)
     if (!is_el && !is_iz)
         return;
 
+    // 换场地会重置整个场地, 只能完整布阵
+    if (diff && GetScene() == lineup.scene && set_lineup_diff(lineup, is_iz))
+        return;
+
     ClearGridItems({1, 2, 3, 11});
     ClearAllPlants();
 
@@ -1973,10 +2384,10 @@ void PvZ::SetLineup(Lineup lineup)
     {
         for (size_t c = 0; c < 9; c++)
         {
-            if (lineup.base[r * 9 + c] == 1)
-                asm_put_plant(r, c, 16, lineup.base_im[r * 9 + c] == 1, is_iz);
-            else if (lineup.base[r * 9 + c] == 2)
-                asm_put_plant(r, c, 33, lineup.base_im[r * 9 + c] == 1, is_iz);
+            if (lineup.base()[r * 9 + c] == 1)
+                asm_put_plant(r, c, 16, lineup.base_im()[r * 9 + c] == 1, is_iz);
+            else if (lineup.base()[r * 9 + c] == 2)
+                asm_put_plant(r, c, 33, lineup.base_im()[r * 9 + c] == 1, is_iz);
         }
     }
     // 主要植物
@@ -1984,44 +2395,13 @@ void PvZ::SetLineup(Lineup lineup)
     {
         for (size_t c = 0; c < 9; c++)
         {
-            if (lineup.plant[r * 9 + c] == 0)
+            if (lineup.plant()[r * 9 + c] == 0)
                 continue;
 
-            int plant_type = lineup.plant[r * 9 + c] - 1;
-            bool plant_imitater = lineup.plant_im[r * 9 + c] == 1;
-            bool plant_asleep = lineup.plant_awake[r * 9 + c] == 0;
-
-            if (plant_type < 0 || plant_type > 47       //
-                || plant_type == 16 || plant_type == 33 //
-                || plant_type == 30 || plant_type == 35)
-                continue;
-
-            asm_put_plant(r, c, plant_type, plant_imitater, is_iz);
-
-            // 蘑菇类植物唤醒
-            if ((lineup.scene == 0 || lineup.scene == 2 || lineup.scene == 4) //
-                && lineup.may_sleep[plant_type] && !plant_asleep)
-            {
-                asm_push_exx(Reg::EAX);
-                if (isGOTY())
-                    asm_mov_exx_exx(Reg::EDI, Reg::EAX);
-                else if (isBETA())
-                    asm_mov_exx_exx(Reg::ECX, Reg::EAX);
-                asm_push_byte(0);
-                asm_call(data().call_set_plant_sleeping);
-                asm_pop_exx(Reg::EAX);
-            }
-
-            // 土豆雷和阳光菇长大
-            // mov [eax+54],00000001
-            if (plant_type == 4 || plant_type == 9)
-            {
-                if (isBETA())
-                    asm_add_list(0xc7, 0x40, 0x5c);
-                else
-                    asm_add_list(0xc7, 0x40, 0x54);
-                asm_add_dword(1);
-            }
+            int plant_type = lineup.plant()[r * 9 + c] - 1;
+            bool plant_imitater = lineup.plant_im()[r * 9 + c] == 1;
+            bool plant_asleep = lineup.plant_awake()[r * 9 + c] == 0;
+            asm_put_lineup_plant(r, c, plant_type, plant_imitater, plant_asleep, lineup.scene, is_iz);
         }
     }
     // 南瓜壳
@@ -2029,8 +2409,8 @@ void PvZ::SetLineup(Lineup lineup)
     {
         for (size_t c = 0; c < 9; c++)
         {
-            if (lineup.pumpkin[r * 9 + c] == 1)
-                asm_put_plant(r, c, 30, lineup.pumpkin_im[r * 9 + c] == 1, is_iz);
+            if (lineup.pumpkin()[r * 9 + c] == 1)
+                asm_put_plant(r, c, 30, lineup.pumpkin_im()[r * 9 + c] == 1, is_iz);
         }
     }
     // 咖啡豆
@@ -2038,8 +2418,8 @@ void PvZ::SetLineup(Lineup lineup)
     {
         for (size_t c = 0; c < 9; c++)
         {
-            if (lineup.coffee[r * 9 + c] == 1)
-                asm_put_plant(r, c, 35, lineup.coffee_im[r * 9 + c] == 1, is_iz);
+            if (lineup.coffee()[r * 9 + c] == 1)
+                asm_put_plant(r, c, 35, lineup.coffee_im()[r * 9 + c] == 1, is_iz);
         }
     }
     // 墓碑
@@ -2047,7 +2427,7 @@ void PvZ::SetLineup(Lineup lineup)
     {
         for (size_t c = 0; c < 9; c++)
         {
-            if (lineup.base[r * 9 + c] == 3)
+            if (lineup.base()[r * 9 + c] == 3)
                 asm_put_grave(r, c);
         }
     }
@@ -2056,7 +2436,7 @@ void PvZ::SetLineup(Lineup lineup)
     {
         for (size_t c = 0; c < 9; c++)
         {
-            if (lineup.ladder[r * 9 + c] == 1)
+            if (lineup.ladder()[r * 9 + c] == 1)
                 asm_put_ladder(r, c);
         }
     }
@@ -2205,132 +2585,16 @@ void PvZ::CustomizeSpawn(std::array<bool, 33> zombies, bool limit_giga, bool sim
     if (ui != 2 && ui != 3)
         return;
 
-    std::array<bool, 20> giga_waves;
-    giga_waves.fill(true);
-    if (limit_giga)
-        for (size_t w = 11; w <= 19; w++)
-            giga_waves[w - 1] = false;
-
-    std::vector<double> weights = {
-        4000, // 普僵
-        0,    // 旗帜
-        4000, // 路障
-        2000, // 撑杆
-        3000, // 铁桶
-        1000, // 读报
-        3500, // 铁门
-        2000, // 橄榄
-        1000, // 舞王
-        0,    // 伴舞
-        0,    // 鸭子
-        2000, // 潜水
-        2000, // 冰车
-        2000, // 雪橇
-        1500, // 海豚
-        1000, // 小丑
-        2000, // 气球
-        1000, // 矿工
-        1000, // 跳跳
-        1,    // 雪人
-        1000, // 蹦极
-        1000, // 扶梯
-        1500, // 投篮
-        1500, // 白眼
-        0,    // 小鬼
-        0,    // 僵博
-        4000, // 豌豆
-        3000, // 坚果
-        1000, // 辣椒
-        2000, // 机枪
-        2000, // 窝瓜
-        2000, // 高墙
-        6000  // 红眼
-    };
-
 #ifdef _DEBUG
     if (this->find_result == PVZ_1_0_0_1051_EN)
         for (size_t i = 0; i < 33; i++)
-            assert(ReadMemory<int>({0x0069da94 + i * 0x1c}) == static_cast<int>(weights[i]));
+            assert(ReadMemory<int>({0x0069da94 + i * 0x1c}) == zombie_spawn_weights[i]);
 #endif
 
-    weights[0] = 400;
-    weights[2] = 1000;
-    std::vector<double> weights_flag = weights;
-    weights[32] = giga_weight;
-    std::vector<double> weights_normal = weights;
-    std::discrete_distribution<unsigned int> dist_flag(weights_flag.begin(), weights_flag.end());
-    std::discrete_distribution<unsigned int> dist_normal(weights_normal.begin(), weights_normal.end());
+    // 每个格子按别名表抽一次, 不再反复重抽被排除的僵尸
     auto seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-    std::mt19937 gen(static_cast<unsigned int>(seed));
-
-    // 僵尸列表
-    std::array<int, 1000> zombies_list;
-    zombies_list.fill(-1);
-
-    bool has_flag = zombies[1];
-    bool has_yeti = zombies[19];
-    bool has_bungee = zombies[20];
-    bool has_giga = zombies[32];
-
-    bool limit_flag = true;
-    bool limit_yeti = true;
-    bool limit_bungee = true;
-
-    int count = 0;
-    for (size_t i = 0; i < 33; i++)
-        if (zombies[i])
-            count++;
-
-    if (count > 0)
-    {
-        int type = 0;
-        for (size_t i = 0; i < 1000; i++)
-        {
-            do
-            {
-                if (simulate)
-                {
-                    if (((i / 50) % 10) == 9) // 旗帜波
-                        type = dist_flag(gen);
-                    else
-                        type = dist_normal(gen);
-                }
-                else
-                {
-                    type += 1;
-                    type %= 33;
-                }
-            } while ((!zombies[type])                                                          //
-                     || (has_flag && limit_flag && type == 1)                                  //
-                     || (has_yeti && limit_yeti && type == 19)                                 //
-                     || (has_bungee && limit_bungee && type == 20)                             //
-                     || (has_giga && limit_giga && type == 32 && !giga_waves[(i / 50) % 20])); //
-
-            zombies_list[i] = type;
-        }
-
-        std::vector<size_t> index_flag = {450,                                       //
-                                          950};                                      //
-        std::vector<size_t> index_zombie = {451, 452, 453, 454, 455, 456, 457, 458,  //
-                                            951, 952, 953, 954, 955, 956, 957, 958}; //
-        std::vector<size_t> index_bungee = {459, 460, 461, 462,                      //
-                                            959, 960, 961, 962};                     //
-
-        if ((has_flag && limit_flag) || simulate)
-            for (auto i : index_flag)
-                zombies_list[i] = 1;
-
-        if (simulate)
-            for (auto i : index_zombie)
-                zombies_list[i] = 0;
-
-        if (has_bungee && limit_bungee)
-            for (auto i : index_bungee)
-                zombies_list[i] = 20;
-
-        if (has_yeti && limit_yeti)
-            zombies_list[rand() % 1000] = 19;
-    }
+    std::array<int, 1000> zombies_list = GenerateSpawnList(zombies, limit_giga, simulate, giga_weight, //
+                                                           static_cast<uint32_t>(seed));
 
     WriteMemory(zombies_list, {data().lawn, data().board, data().spawn_list});
     if (ui == 2)
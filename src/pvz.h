@@ -9,6 +9,7 @@
 #include <cassert>
 #include <random>
 #include <chrono>
+#include <mutex>
 
 #include <Windows.h>
 
@@ -22,6 +23,21 @@ namespace Pt
 
 typedef void (*cb_func)(void *, int);
 
+// 版本表修订号, 每次往版本表里添加或修改版本时加一
+// 索引里修订号不同的项是旧版本工具写的, 结果可能已经过时, 直接忽略
+#define VERSION_TABLE_REVISION 1
+
+// 版本索引的一项
+// 同一个进程由 PID 和启动时间唯一确定, 同一个游戏文件由模块哈希确定
+struct VERSION_INDEX_ITEM
+{
+    uint32_t pid;
+    uint32_t module_hash;
+    uint64_t start_time;
+    int32_t find_result;
+    int32_t revision; // VERSION_TABLE_REVISION
+};
+
 class PvZ : public Process, public Code, public Data
 {
   public:
@@ -45,6 +61,12 @@ class PvZ : public Process, public Code, public Data
     // 查找植物大战僵尸, 找到了支持的版本返回真
     bool FindPvZ();
 
+    // 只连接指定窗口的游戏, 之后重新查找也只找这个窗口
+    bool FindPvZ(HWND);
+
+    // 所有可能是游戏的窗口
+    static std::vector<HWND> FindWindows();
+
     // 游戏是否正常开启
     // 每次修改前都要检查
     bool GameOn();
@@ -70,6 +92,26 @@ class PvZ : public Process, public Code, public Data
     cb_func cb_find_result;
     void *window;
 
+    // 固定连接的窗口, 为空时查找所有窗口
+    HWND pinned_hwnd;
+
+    // 打开窗口所在进程并识别游戏版本
+    int attach(HWND);
+
+    // 识别当前打开的进程的游戏版本
+    int detect_version();
+
+    // 版本索引, 跨运行保存在注册表里
+    // 所有实例共用一份, 多个实例在各自线程上并行连接时由互斥锁保护
+    static std::vector<VERSION_INDEX_ITEM> version_index;
+    static std::mutex version_index_mutex;
+    static std::once_flag version_index_once;
+    static void load_version_index();
+    static void save_version_index(); // 调用时要持有锁
+
+    // 增量布阵, 读取失败时返回 false
+    bool set_lineup_diff(const Lineup &, bool);
+
   public:
     // 以下是修改功能
 
@@ -153,12 +195,14 @@ class PvZ : public Process, public Code, public Data
     void SetLawnMowers(int);
 
     // 清除所有植物
+    void asm_delete_plant(uintptr_t);
     void ClearAllPlants();
 
     // 杀死所有僵尸
     void KillAllZombies();
 
     // 清理场地物品
+    void asm_delete_grid_item(uintptr_t);
     void ClearGridItems(std::vector<int>);
 
     // 植物无敌
@@ -215,8 +259,9 @@ class PvZ : public Process, public Code, public Data
     // 获取代码
     Lineup GetLineup();
 
-    // 布置阵型
-    void SetLineup(Lineup);
+    // 布置阵型, diff 为 true 时只修改和当前场地不同的格子
+    void asm_put_lineup_plant(int, int, int, bool, bool, int, bool);
+    void SetLineup(Lineup, bool diff = false);
 
     // 根据出怪种类生成出怪列表
     void generate_spawn_list();
@@ -230,7 +275,7 @@ class PvZ : public Process, public Code, public Data
     // 修改刷怪列表
     void SetSpawnList(std::array<int, 1000>);
 
-    // 内置函数生成出怪列表
+    // 内置函数生成出怪列表, native 为 true 时在工具里按同样的流程生成
     void InternalSpawn(std::array<bool, 33>);
 
     // 自定义填充出怪列表
@@ -0,0 +1,106 @@
+
+#include "simd.h"
+
+#if defined(PTK_SIMD_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace Pt
+{
+
+#if defined(PTK_SIMD_X86)
+
+static void cpuid(int leaf, int sub_leaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex((int *)regs, leaf, sub_leaf);
+#else
+    __cpuid_count(leaf, sub_leaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+struct CPU_FEATURES
+{
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool avx2 = false;
+
+    CPU_FEATURES()
+    {
+        unsigned int regs[4] = {0};
+        cpuid(0, 0, regs);
+        unsigned int max_leaf = regs[0];
+        if (max_leaf < 1)
+            return;
+
+        cpuid(1, 0, regs);
+        sse2 = (regs[3] & (1 << 26)) != 0;
+        ssse3 = (regs[2] & (1 << 9)) != 0;
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx = (regs[2] & (1 << 28)) != 0;
+
+        // AVX2 还需要系统保存 YMM 寄存器状态
+        if (max_leaf < 7 || !osxsave || !avx || (xgetbv0() & 0x6) != 0x6)
+            return;
+
+        cpuid(7, 0, regs);
+        avx2 = (regs[1] & (1 << 5)) != 0;
+    }
+};
+
+static const CPU_FEATURES &cpu_features()
+{
+    static const CPU_FEATURES features;
+    return features;
+}
+
+bool CpuHasSSE2()
+{
+    return cpu_features().sse2;
+}
+
+bool CpuHasSSSE3()
+{
+    return cpu_features().ssse3;
+}
+
+bool CpuHasAVX2()
+{
+    return cpu_features().avx2;
+}
+
+#else
+
+bool CpuHasSSE2()
+{
+    return false;
+}
+
+bool CpuHasSSSE3()
+{
+    return false;
+}
+
+bool CpuHasAVX2()
+{
+    return false;
+}
+
+#endif
+
+} // namespace Pt
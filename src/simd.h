@@ -0,0 +1,28 @@
+
+#pragma once
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PTK_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// MSVC 可以直接使用所有指令集的内建函数, GCC/Clang 需要给函数单独指定目标
+#if defined(_MSC_VER)
+#define PTK_TARGET_SSE2
+#define PTK_TARGET_SSSE3
+#define PTK_TARGET_AVX2
+#else
+#define PTK_TARGET_SSE2 __attribute__((target("sse2")))
+#define PTK_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define PTK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace Pt
+{
+
+// 运行时检测 CPU 支持的指令集, 只检测一次
+bool CpuHasSSE2();
+bool CpuHasSSSE3();
+bool CpuHasAVX2();
+
+} // namespace Pt
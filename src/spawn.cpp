@@ -0,0 +1,647 @@
+
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#include "spawn.h"
+#include "simd.h"
+
+namespace Pt
+{
+
+const int zombie_spawn_weights[33] = {
+    4000, // 普僵
+    0,    // 旗帜
+    4000, // 路障
+    2000, // 撑杆
+    3000, // 铁桶
+    1000, // 读报
+    3500, // 铁门
+    2000, // 橄榄
+    1000, // 舞王
+    0,    // 伴舞
+    0,    // 鸭子
+    2000, // 潜水
+    2000, // 冰车
+    2000, // 雪橇
+    1500, // 海豚
+    1000, // 小丑
+    2000, // 气球
+    1000, // 矿工
+    1000, // 跳跳
+    1,    // 雪人
+    1000, // 蹦极
+    1000, // 扶梯
+    1500, // 投篮
+    1500, // 白眼
+    0,    // 小鬼
+    0,    // 僵博
+    4000, // 豌豆
+    3000, // 坚果
+    1000, // 辣椒
+    2000, // 机枪
+    2000, // 窝瓜
+    2000, // 高墙
+    6000  // 红眼
+};
+
+AliasTable::AliasTable()
+{
+}
+
+AliasTable::~AliasTable()
+{
+}
+
+void AliasTable::Build(std::span<const double> weights)
+{
+    prob.clear();
+    alias.clear();
+
+    double total = 0;
+    for (double w : weights)
+        if (w > 0)
+            total += w;
+    if (total <= 0)
+        return;
+
+    size_t n = weights.size();
+    prob.resize(n);
+    alias.resize(n);
+
+    // 每列的平均值为 1, 小于 1 的用大于 1 的补齐
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < n; i++)
+    {
+        scaled[i] = (weights[i] > 0 ? weights[i] : 0) * n / total;
+        if (scaled[i] < 1.0)
+            small.push_back((uint32_t)i);
+        else
+            large.push_back((uint32_t)i);
+    }
+
+    const double one = 4294967296.0; // 2^32
+    while (!small.empty() && !large.empty())
+    {
+        uint32_t s = small.back();
+        small.pop_back();
+        uint32_t l = large.back();
+        large.pop_back();
+
+        prob[s] = (uint64_t)(scaled[s] * one);
+        alias[s] = l;
+
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0)
+            small.push_back(l);
+        else
+            large.push_back(l);
+    }
+
+    // 剩下的只差浮点误差, 直接当作 1
+    for (uint32_t i : large)
+    {
+        prob[i] = (uint64_t)1 << 32;
+        alias[i] = i;
+    }
+    for (uint32_t i : small)
+    {
+        prob[i] = (uint64_t)1 << 32;
+        alias[i] = i;
+    }
+}
+
+bool AliasTable::Empty() const
+{
+    return prob.empty();
+}
+
+size_t AliasTable::Size() const
+{
+    return prob.size();
+}
+
+std::array<int, 1000> GenerateSpawnList(const std::array<bool, 33> &zombies, bool limit_giga, bool simulate,
+                                        int giga_weight, uint32_t seed)
+{
+    // 僵尸列表
+    std::array<int, 1000> zombies_list;
+    zombies_list.fill(-1);
+
+    int count = 0;
+    for (size_t i = 0; i < 33; i++)
+        if (zombies[i])
+            count++;
+    if (count == 0)
+        return zombies_list;
+
+    std::mt19937 gen(seed);
+
+    std::array<bool, 20> giga_waves;
+    giga_waves.fill(true);
+    if (limit_giga)
+        for (size_t w = 11; w <= 19; w++)
+            giga_waves[w - 1] = false;
+
+    bool has_flag = zombies[1];
+    bool has_yeti = zombies[19];
+    bool has_bungee = zombies[20];
+    bool has_giga = zombies[32];
+
+    bool limit_flag = true;
+    bool limit_yeti = true;
+    bool limit_bungee = true;
+
+    // 每个格子能出的僵尸只和红眼能不能出有关, 旗帜, 雪人, 蹦极另外放
+    std::array<bool, 33> allowed[2]; // [红眼能出]
+    for (size_t g = 0; g < 2; g++)
+    {
+        for (size_t type = 0; type < 33; type++)
+        {
+            allowed[g][type] = zombies[type]                                 //
+                               && !(has_flag && limit_flag && type == 1)     //
+                               && !(has_yeti && limit_yeti && type == 19)    //
+                               && !(has_bungee && limit_bungee && type == 20) //
+                               && !(has_giga && limit_giga && type == 32 && g == 0);
+        }
+    }
+
+    // 旗帜波和普通波的权重不同, 按 (旗帜波, 红眼能出) 建 4 张别名表
+    AliasTable tables[2][2];
+    if (simulate)
+    {
+        std::vector<double> weights_flag(zombie_spawn_weights, zombie_spawn_weights + 33);
+        weights_flag[0] = 400;
+        weights_flag[2] = 1000;
+        std::vector<double> weights_normal = weights_flag;
+        weights_normal[32] = giga_weight;
+
+        for (size_t f = 0; f < 2; f++)
+        {
+            for (size_t g = 0; g < 2; g++)
+            {
+                std::vector<double> weights = f ? weights_flag : weights_normal;
+                bool any_weight = false;
+                for (size_t type = 0; type < 33; type++)
+                {
+                    if (!allowed[g][type])
+                        weights[type] = 0;
+                    any_weight = any_weight || weights[type] > 0;
+                }
+                // 选中的都是权重为 0 的, 改为等概率
+                if (!any_weight)
+                    for (size_t type = 0; type < 33; type++)
+                        weights[type] = allowed[g][type] ? 1 : 0;
+                tables[f][g].Build(weights);
+            }
+        }
+    }
+
+    int type = 0;
+    for (size_t i = 0; i < 1000; i++)
+    {
+        size_t g = giga_waves[(i / 50) % 20] ? 1 : 0;
+        if (simulate)
+        {
+            size_t f = (((i / 50) % 10) == 9) ? 1 : 0; // 旗帜波
+            if (!tables[f][g].Empty())
+                zombies_list[i] = tables[f][g](gen);
+        }
+        else
+        {
+            // 从上一个开始依次找下一个能出的
+            for (size_t step = 0; step < 33; step++)
+            {
+                type = (type + 1) % 33;
+                if (allowed[g][type])
+                {
+                    zombies_list[i] = type;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> index_flag = {450,                                       //
+                                      950};                                      //
+    std::vector<size_t> index_zombie = {451, 452, 453, 454, 455, 456, 457, 458,  //
+                                        951, 952, 953, 954, 955, 956, 957, 958}; //
+    std::vector<size_t> index_bungee = {459, 460, 461, 462,                      //
+                                        959, 960, 961, 962};                     //
+
+    if ((has_flag && limit_flag) || simulate)
+        for (auto i : index_flag)
+            zombies_list[i] = 1;
+
+    if (simulate)
+        for (auto i : index_zombie)
+            zombies_list[i] = 0;
+
+    if (has_bungee && limit_bungee)
+        for (auto i : index_bungee)
+            zombies_list[i] = 20;
+
+    if (has_yeti && limit_yeti)
+        zombies_list[((uint64_t)gen() * 1000) >> 32] = 19;
+
+    return zombies_list;
+}
+
+SPAWN_STATS EstimateSpawnStats(const SpawnGenerator &generator, size_t samples, uint32_t seed, unsigned int threads)
+{
+    SPAWN_STATS stats;
+    if (samples == 0 || !generator)
+        return stats;
+
+    // 直方图, 单波最多 50 只, 整轮最多 1000 只
+    const size_t wave_bins = 50 + 1;
+    const size_t total_bins = 1000 + 1;
+    const size_t wave_offset = 0;
+    const size_t total_offset = 33 * 20 * wave_bins;
+    const size_t hist_size = total_offset + 33 * total_bins;
+
+    auto bin = [&](size_t type, size_t col, size_t count) -> size_t
+    {
+        if (col < 20)
+            return wave_offset + (type * 20 + col) * wave_bins + count;
+        return total_offset + type * total_bins + count;
+    };
+
+    const size_t min_per_thread = 64;
+    const size_t chunk = 32;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned int)std::min<size_t>(threads, (samples + min_per_thread - 1) / min_per_thread);
+
+    std::vector<uint32_t> hist(hist_size, 0);
+    std::mutex hist_mutex;
+    std::atomic<size_t> next{0};
+    auto work = [&]()
+    {
+        std::vector<uint32_t> local(hist_size, 0);
+        int count[33][20 + 1];
+        size_t begin;
+        while ((begin = next.fetch_add(chunk)) < samples)
+        {
+            size_t end = std::min(begin + chunk, samples);
+            for (size_t i = begin; i < end; i++)
+            {
+                std::array<int, 1000> zl = generator(seed + (uint32_t)i);
+                std::fill(&count[0][0], &count[0][0] + 33 * (20 + 1), 0);
+                for (size_t w = 0; w < 20; w++)
+                {
+                    // 和游戏一样遇到 -1 之后的忽略
+                    for (size_t j = 0; j < 50; j++)
+                    {
+                        int type = zl[w * 50 + j];
+                        if (type < 0 || type >= 33)
+                            break;
+                        count[type][w]++;
+                        count[type][20]++;
+                    }
+                }
+                for (size_t type = 0; type < 33; type++)
+                    for (size_t col = 0; col < 20 + 1; col++)
+                        local[bin(type, col, count[type][col])]++;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(hist_mutex);
+        for (size_t i = 0; i < hist_size; i++)
+            hist[i] += local[i];
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; i++)
+        workers.emplace_back(work);
+    work(); // 当前线程也干活
+    for (auto &t : workers)
+        t.join();
+
+    stats.samples = samples;
+    for (size_t type = 0; type < 33; type++)
+    {
+        for (size_t col = 0; col < 20 + 1; col++)
+        {
+            size_t bins = col < 20 ? wave_bins : total_bins;
+            const uint32_t *h = &hist[bin(type, col, 0)];
+
+            uint64_t sum = 0;
+            for (size_t c = 0; c < bins; c++)
+                sum += (uint64_t)h[c] * c;
+            stats.mean[type][col] = (float)((double)sum / samples);
+            stats.prob[type][col] = (float)((double)(samples - h[0]) / samples);
+
+            // 累计数量第一次达到对应比例的格子
+            auto quantile = [&](double q) -> int
+            {
+                uint64_t target = (uint64_t)(q * samples + 0.5);
+                uint64_t acc = 0;
+                for (size_t c = 0; c < bins; c++)
+                {
+                    acc += h[c];
+                    if (acc >= target && acc > 0)
+                        return (int)c;
+                }
+                return (int)bins - 1;
+            };
+            stats.p10[type][col] = quantile(0.1);
+            stats.p50[type][col] = quantile(0.5);
+            stats.p90[type][col] = quantile(0.9);
+        }
+    }
+
+    return stats;
+}
+
+static bool parse_int(std::string_view text, int &value)
+{
+    if (text.empty() || text.size() > 4)
+        return false;
+    value = 0;
+    for (char c : text)
+    {
+        if (c < '0' || c > '9')
+            return false;
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+bool ParseSpawnConstraints(std::string_view text, std::vector<SPAWN_CONSTRAINT> &constraints)
+{
+    constraints.clear();
+
+    size_t i = 0;
+    while (true)
+    {
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\t'))
+            i++;
+        if (i >= text.size())
+            break;
+
+        size_t begin = i;
+        while (i < text.size() && text[i] != ' ' && text[i] != '\t')
+            i++;
+        std::string_view term = text.substr(begin, i - begin);
+
+        // 比较符号
+        size_t op = term.find_first_of("<>=");
+        if (op == std::string_view::npos)
+            return false;
+        size_t op_len = (op + 1 < term.size() && term[op + 1] == '=' && term[op] != '=') ? 2 : 1;
+        std::string_view lhs = term.substr(0, op);
+        std::string_view cmp = term.substr(op, op_len);
+        int n;
+        if (!parse_int(term.substr(op + op_len), n))
+            return false;
+
+        SPAWN_CONSTRAINT constraint = {0, 1, 20, 0, 1000};
+
+        // 种类和波次
+        size_t at = lhs.find('@');
+        if (!parse_int(lhs.substr(0, at), constraint.type) || constraint.type >= 33)
+            return false;
+        if (at != std::string_view::npos)
+        {
+            std::string_view waves = lhs.substr(at + 1);
+            size_t dash = waves.find('-');
+            if (!parse_int(waves.substr(0, dash), constraint.wave_first))
+                return false;
+            constraint.wave_last = constraint.wave_first;
+            if (dash != std::string_view::npos && !parse_int(waves.substr(dash + 1), constraint.wave_last))
+                return false;
+            if (constraint.wave_first < 1 || constraint.wave_last > 20 || constraint.wave_first > constraint.wave_last)
+                return false;
+        }
+
+        if (cmp == ">=")
+            constraint.min = n;
+        else if (cmp == ">")
+            constraint.min = n + 1;
+        else if (cmp == "<=")
+            constraint.max = n;
+        else if (cmp == "<")
+        {
+            if (n == 0)
+                return false;
+            constraint.max = n - 1;
+        }
+        else if (cmp == "=")
+            constraint.min = constraint.max = n;
+        else
+            return false;
+
+        constraints.push_back(constraint);
+    }
+
+    return !constraints.empty();
+}
+
+void SPAWN_HISTOGRAM::Build(const std::array<int, 1000> &zl)
+{
+    std::fill(&count[0][0], &count[0][0] + sizeof(count), (uint8_t)0);
+    for (size_t w = 0; w < 20; w++)
+    {
+        for (size_t j = 0; j < 50; j++)
+        {
+            int type = zl[w * 50 + j];
+            if (type < 0 || type >= 33)
+                break;
+            count[type][w]++;
+        }
+    }
+}
+
+// 一行 32 波里 [first, last) 的数量之和
+
+static int sum_waves_scalar(const uint8_t *row, int first, int last)
+{
+    int sum = 0;
+    for (int w = first; w < last; w++)
+        sum += row[w];
+    return sum;
+}
+
+#if defined(PTK_SIMD_X86)
+
+// 波次序号和范围比较得到掩码, 与之后用 SAD 对 0 求和, 每 8 个字节得到一个 64 位的和
+
+PTK_TARGET_SSE2
+static int sum_waves_sse2(const uint8_t *row, int first, int last)
+{
+    const __m128i index_lo = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i index_hi = _mm_add_epi8(index_lo, _mm_set1_epi8(16));
+    const __m128i lower = _mm_set1_epi8((char)(first - 1)); // index > first - 1
+    const __m128i upper = _mm_set1_epi8((char)last);        // index < last
+    __m128i mask_lo = _mm_and_si128(_mm_cmpgt_epi8(index_lo, lower), _mm_cmplt_epi8(index_lo, upper));
+    __m128i mask_hi = _mm_and_si128(_mm_cmpgt_epi8(index_hi, lower), _mm_cmplt_epi8(index_hi, upper));
+    __m128i lo = _mm_and_si128(_mm_load_si128((const __m128i *)row), mask_lo);
+    __m128i hi = _mm_and_si128(_mm_load_si128((const __m128i *)(row + 16)), mask_hi);
+    __m128i sad = _mm_add_epi64(_mm_sad_epu8(lo, _mm_setzero_si128()), _mm_sad_epu8(hi, _mm_setzero_si128()));
+    sad = _mm_add_epi64(sad, _mm_unpackhi_epi64(sad, sad));
+    return _mm_cvtsi128_si32(sad);
+}
+
+PTK_TARGET_AVX2
+static int sum_waves_avx2(const uint8_t *row, int first, int last)
+{
+    const __m256i index = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, //
+                                           16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+    __m256i mask = _mm256_andnot_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8((char)first), index), //
+                                       _mm256_cmpgt_epi8(_mm256_set1_epi8((char)last), index));
+    __m256i values = _mm256_and_si256(_mm256_load_si256((const __m256i *)row), mask);
+    __m256i sad = _mm256_sad_epu8(values, _mm256_setzero_si256());
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sad), _mm256_extracti128_si256(sad, 1));
+    sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+    return _mm_cvtsi128_si32(sum);
+}
+
+#endif
+
+static int sum_waves(const uint8_t *row, int first, int last)
+{
+    using SumWaves = int (*)(const uint8_t *, int, int);
+    static const SumWaves impl = []() -> SumWaves
+    {
+#if defined(PTK_SIMD_X86)
+        if (CpuHasAVX2())
+            return sum_waves_avx2;
+        if (CpuHasSSE2())
+            return sum_waves_sse2;
+#endif
+        return sum_waves_scalar;
+    }();
+    return impl(row, first, last);
+}
+
+int SPAWN_HISTOGRAM::Distance(const std::vector<SPAWN_CONSTRAINT> &constraints) const
+{
+    int distance = 0;
+    for (const auto &c : constraints)
+    {
+        int sum = sum_waves(count[c.type], c.wave_first - 1, c.wave_last);
+        if (sum < c.min)
+            distance += c.min - sum;
+        else if (sum > c.max)
+            distance += sum - c.max;
+    }
+    return distance;
+}
+
+int SpawnConstraintsDistance(const std::array<int, 1000> &zombies_list, const std::vector<SPAWN_CONSTRAINT> &constraints)
+{
+    SPAWN_HISTOGRAM histogram;
+    histogram.Build(zombies_list);
+    return histogram.Distance(constraints);
+}
+
+std::vector<SPAWN_SEARCH_RESULT> SearchSpawnSeeds(const SpawnGenerator &generator,
+                                                  const std::vector<SPAWN_CONSTRAINT> &constraints, //
+                                                  uint32_t first_seed, size_t count, size_t top_k,
+                                                  bool stop_on_first, unsigned int threads,
+                                                  const std::atomic<bool> *cancel)
+{
+    std::vector<SPAWN_SEARCH_RESULT> results;
+    if (count == 0 || !generator)
+        return results;
+    if (stop_on_first)
+        top_k = 1;
+    if (top_k == 0)
+        return results;
+
+    const size_t min_per_thread = 64;
+    const size_t chunk = 64;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned int)std::min<size_t>(threads, (count + min_per_thread - 1) / min_per_thread);
+
+    // 按 (差距, 序号) 排序, 序号小的优先, 结果才和线程数无关
+    struct CANDIDATE
+    {
+        int distance;
+        size_t index;
+        bool operator<(const CANDIDATE &o) const
+        {
+            return distance != o.distance ? distance < o.distance : index < o.index;
+        }
+    };
+
+    std::vector<CANDIDATE> best;
+    std::mutex best_mutex;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> first_match{SIZE_MAX}; // 已经找到的最小序号
+    auto work = [&]()
+    {
+        std::vector<CANDIDATE> local; // 最大堆, 堆顶为当前第 k 好的
+        SPAWN_HISTOGRAM histogram;
+        size_t begin;
+        while ((begin = next.fetch_add(chunk)) < count)
+        {
+            // 按顺序分块, 比已经找到的更靠后的块不用再算
+            if (stop_on_first && begin > first_match.load(std::memory_order_relaxed))
+                break;
+            if (cancel != nullptr && cancel->load(std::memory_order_relaxed))
+                break;
+
+            size_t end = std::min(begin + chunk, count);
+            for (size_t i = begin; i < end; i++)
+            {
+                histogram.Build(generator(first_seed + (uint32_t)i));
+                CANDIDATE candidate = {histogram.Distance(constraints), i};
+
+                if (stop_on_first)
+                {
+                    if (candidate.distance == 0)
+                    {
+                        size_t current = first_match.load();
+                        while (i < current && !first_match.compare_exchange_weak(current, i))
+                            ;
+                        break;
+                    }
+                    continue;
+                }
+
+                if (local.size() < top_k)
+                {
+                    local.push_back(candidate);
+                    std::push_heap(local.begin(), local.end());
+                }
+                else if (candidate < local.front())
+                {
+                    std::pop_heap(local.begin(), local.end());
+                    local.back() = candidate;
+                    std::push_heap(local.begin(), local.end());
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(best_mutex);
+        best.insert(best.end(), local.begin(), local.end());
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; i++)
+        workers.emplace_back(work);
+    work(); // 当前线程也干活
+    for (auto &t : workers)
+        t.join();
+
+    if (stop_on_first)
+    {
+        if (first_match != SIZE_MAX)
+            results.push_back({first_seed + (uint32_t)first_match.load(), 0});
+        return results;
+    }
+
+    std::sort(best.begin(), best.end());
+    if (best.size() > top_k)
+        best.resize(top_k);
+    for (const auto &c : best)
+        results.push_back({first_seed + (uint32_t)c.index, c.distance});
+    return results;
+}
+
+} // namespace Pt
@@ -0,0 +1,113 @@
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <span>
+#include <vector>
+#include <random>
+#include <functional>
+#include <atomic>
+#include <string_view>
+
+namespace Pt
+{
+
+// 出怪权重, 和游戏里僵尸数据表的一致
+extern const int zombie_spawn_weights[33];
+
+// Vose 别名表, 预处理之后每次抽取都是 O(1)
+// 抽取只用 mt19937 的原始输出, 相同的种子在不同的编译器上结果也相同
+class AliasTable
+{
+  public:
+    AliasTable();
+    ~AliasTable();
+
+    // 权重全为 0 (或者为空) 时表为空
+    void Build(std::span<const double>);
+    bool Empty() const;
+    size_t Size() const;
+
+    int operator()(std::mt19937 &gen) const
+    {
+        // 第一个数选列, 第二个数决定取这一列本身还是别名
+        uint32_t column = (uint32_t)(((uint64_t)gen() * prob.size()) >> 32);
+        uint32_t coin = gen();
+        return (coin < prob[column]) ? (int)column : (int)alias[column];
+    }
+
+  private:
+    std::vector<uint64_t> prob; // 乘以 2^32 之后的接受概率, 1.0 存为 2^32
+    std::vector<uint32_t> alias;
+};
+
+// 生成出怪列表, 纯函数, 相同的参数和种子结果相同
+// zombies 选中的僵尸, limit_giga 红眼只在部分波次出现, simulate 按游戏权重模拟, 否则依次轮流
+// 没有可以出的僵尸的格子为 -1
+std::array<int, 1000> GenerateSpawnList(const std::array<bool, 33> &zombies, bool limit_giga, bool simulate,
+                                        int giga_weight, uint32_t seed);
+
+// 多次生成出怪列表的统计结果, 下标为 [僵尸种类][波次], 最后一列为整轮
+struct SPAWN_STATS
+{
+    size_t samples = 0;
+    float mean[33][20 + 1] = {{0}}; // 平均数量
+    float prob[33][20 + 1] = {{0}}; // 至少出现一只的概率
+    int p10[33][20 + 1] = {{0}};    // 分位数
+    int p50[33][20 + 1] = {{0}};
+    int p90[33][20 + 1] = {{0}};
+};
+
+// 用于统计的出怪列表生成函数, 参数为种子, 相同的种子结果必须相同
+using SpawnGenerator = std::function<std::array<int, 1000>(uint32_t)>;
+
+// 并行生成 samples 个出怪列表并汇总, 第 i 个样本的种子为 seed + i
+// 每个线程各自统计直方图最后再合并, 所以结果和线程数无关
+SPAWN_STATS EstimateSpawnStats(const SpawnGenerator &generator, size_t samples, uint32_t seed, unsigned int threads = 0);
+
+// 出怪列表的约束条件, 波次范围内 (从 1 开始, 包含两端) 某种僵尸的总数在 [min, max] 之间
+struct SPAWN_CONSTRAINT
+{
+    int type;
+    int wave_first;
+    int wave_last;
+    int min;
+    int max;
+};
+
+// 解析约束条件, 空格分隔, 全部满足才算符合
+// 每条为 种类[@波次[-波次]] 比较 数量, 比较为 >= > <= < =, 省略波次为整轮
+// 例如 "32@1-9=0 8@20>=3" 为前九波没有红眼并且第二十波至少三只舞王
+bool ParseSpawnConstraints(std::string_view, std::vector<SPAWN_CONSTRAINT> &);
+
+// 每种僵尸每波的数量, 波次补齐到 32, 一行正好是一个 AVX2 寄存器或者两个 SSE2 寄存器
+// Distance 按 CPU 支持的指令集用掩码加 SAD 指令对波次范围求和
+struct SPAWN_HISTOGRAM
+{
+    alignas(32) uint8_t count[33][32];
+
+    void Build(const std::array<int, 1000> &);
+    int Distance(const std::vector<SPAWN_CONSTRAINT> &) const;
+};
+
+// 出怪列表和约束条件的差距, 为每条约束超出范围的数量之和, 0 为全部满足
+int SpawnConstraintsDistance(const std::array<int, 1000> &, const std::vector<SPAWN_CONSTRAINT> &);
+
+struct SPAWN_SEARCH_RESULT
+{
+    uint32_t seed;
+    int distance;
+};
+
+// 在 [first_seed, first_seed + count) 里多线程搜索符合约束的种子, 返回的种子用同样的 generator 可以重新生成出怪列表
+// stop_on_first 为 true 时找到后停止, 返回其中最小的种子, 否则返回差距最小的 top_k 个 (差距相同的种子小的优先)
+// 结果和线程数无关, cancel 不为空时可以从其他线程中止
+std::vector<SPAWN_SEARCH_RESULT> SearchSpawnSeeds(const SpawnGenerator &generator,
+                                                  const std::vector<SPAWN_CONSTRAINT> &constraints, //
+                                                  uint32_t first_seed, size_t count, size_t top_k,
+                                                  bool stop_on_first, unsigned int threads = 0,
+                                                  const std::atomic<bool> *cancel = nullptr);
+
+} // namespace Pt
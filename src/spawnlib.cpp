@@ -0,0 +1,198 @@
+
+#include <fstream>
+#include <cstring>
+#include <system_error>
+
+#include "spawnlib.h"
+
+namespace Pt
+{
+
+static_assert(sizeof(SPAWN_LIBRARY_HEADER) == 24);
+static_assert(sizeof(SPAWN_LIBRARY_ENTRY) == 688);
+
+SpawnLibrary::SpawnLibrary()
+{
+    header = nullptr;
+    entries = nullptr;
+}
+
+SpawnLibrary::~SpawnLibrary()
+{
+    Close();
+}
+
+bool SpawnLibrary::Open(const std::filesystem::path &path)
+{
+    Close();
+
+    if (!file.Open(path) || file.Size() < sizeof(SPAWN_LIBRARY_HEADER))
+    {
+        Close();
+        return false;
+    }
+
+    const uint8_t *data = file.Data();
+    const SPAWN_LIBRARY_HEADER *h = (const SPAWN_LIBRARY_HEADER *)data;
+    if (h->magic != SPAWN_LIBRARY_MAGIC || h->version != SPAWN_LIBRARY_VERSION)
+    {
+        Close();
+        return false;
+    }
+
+    // 索引在最后, 正好到文件末尾
+    // 偏移和大小都来自文件, 用减法比较, 避免相加溢出之后绕过检查
+    uint64_t index_size = uint64_t(h->entry_count) * sizeof(SPAWN_LIBRARY_ENTRY);
+    if (h->index_offset < sizeof(SPAWN_LIBRARY_HEADER) || h->index_offset % 8 != 0 //
+        || h->index_offset > file.Size() || index_size != file.Size() - h->index_offset)
+    {
+        Close();
+        return false;
+    }
+
+    // 检查数据范围, 之后读取时不再检查
+    const SPAWN_LIBRARY_ENTRY *e = (const SPAWN_LIBRARY_ENTRY *)(data + h->index_offset);
+    for (size_t i = 0; i < h->entry_count; i++)
+    {
+        if (e[i].data_offset < sizeof(SPAWN_LIBRARY_HEADER) || e[i].data_offset > h->index_offset //
+            || e[i].data_size > h->index_offset - e[i].data_offset)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    header = h;
+    entries = e;
+    return true;
+}
+
+void SpawnLibrary::Close()
+{
+    file.Close();
+    header = nullptr;
+    entries = nullptr;
+}
+
+size_t SpawnLibrary::Count() const
+{
+    return header ? header->entry_count : 0;
+}
+
+const SPAWN_LIBRARY_ENTRY &SpawnLibrary::Entry(size_t i) const
+{
+    return entries[i];
+}
+
+bool SpawnLibrary::List(size_t i, std::array<int, 1000> &zombies_list) const
+{
+    int32_t buffer[1000];
+    uLongf size = sizeof(buffer);
+    const SPAWN_LIBRARY_ENTRY &e = entries[i];
+    if (uncompress((Bytef *)buffer, &size, file.Data() + e.data_offset, e.data_size) != Z_OK //
+        || size != sizeof(buffer))
+        return false;
+    if (crc32(crc32(0L, Z_NULL, 0), (const Bytef *)buffer, sizeof(buffer)) != e.crc)
+        return false;
+
+    for (size_t j = 0; j < 1000; j++)
+        zombies_list[j] = buffer[j];
+    return true;
+}
+
+std::vector<size_t> SpawnLibrary::Find(const std::vector<SPAWN_CONSTRAINT> &constraints) const
+{
+    std::vector<size_t> result;
+    SPAWN_HISTOGRAM histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    for (size_t i = 0; i < Count(); i++)
+    {
+        for (size_t type = 0; type < 33; type++)
+            memcpy(histogram.count[type], entries[i].histogram[type], 20);
+        if (histogram.Distance(constraints) == 0)
+            result.push_back(i);
+    }
+    return result;
+}
+
+int SpawnLibrary::Append(const std::filesystem::path &path, const std::array<int, 1000> &zombies_list, int64_t time)
+{
+    // 读出已有的数据和索引, 连同新的一起写到临时文件再替换
+    std::vector<uint8_t> blobs;
+    std::vector<SPAWN_LIBRARY_ENTRY> index;
+    {
+        SpawnLibrary old;
+        std::error_code ec;
+        if (std::filesystem::exists(path, ec) && !old.Open(path))
+            return -1; // 不覆盖损坏或者不认识的文件
+
+        const uint8_t *data = old.file.Data();
+        for (size_t i = 0; i < old.Count(); i++)
+        {
+            SPAWN_LIBRARY_ENTRY e = old.entries[i];
+            const uint8_t *blob = data + e.data_offset;
+            e.data_offset = sizeof(SPAWN_LIBRARY_HEADER) + blobs.size();
+            blobs.insert(blobs.end(), blob, blob + e.data_size);
+            index.push_back(e);
+        }
+    }
+
+    int32_t buffer[1000];
+    for (size_t j = 0; j < 1000; j++)
+        buffer[j] = zombies_list[j];
+    uLongf size = compressBound(sizeof(buffer));
+    std::vector<uint8_t> compressed(size);
+    if (compress2(compressed.data(), &size, (const Bytef *)buffer, sizeof(buffer), Z_BEST_COMPRESSION) != Z_OK)
+        return -1;
+
+    SPAWN_LIBRARY_ENTRY e;
+    memset(&e, 0, sizeof(e));
+    e.data_offset = sizeof(SPAWN_LIBRARY_HEADER) + blobs.size();
+    e.data_size = (uint32_t)size;
+    e.crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef *)buffer, sizeof(buffer));
+    e.time = time;
+    SPAWN_HISTOGRAM histogram;
+    histogram.Build(zombies_list);
+    for (size_t type = 0; type < 33; type++)
+        memcpy(e.histogram[type], histogram.count[type], 20);
+    blobs.insert(blobs.end(), compressed.begin(), compressed.begin() + size);
+    index.push_back(e);
+
+    // 索引按 8 字节对齐
+    while (blobs.size() % 8 != 0)
+        blobs.push_back(0);
+
+    SPAWN_LIBRARY_HEADER h;
+    memset(&h, 0, sizeof(h));
+    h.magic = SPAWN_LIBRARY_MAGIC;
+    h.version = SPAWN_LIBRARY_VERSION;
+    h.entry_count = (uint32_t)index.size();
+    h.index_offset = sizeof(SPAWN_LIBRARY_HEADER) + blobs.size();
+
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    bool written = false;
+    {
+        std::ofstream ofs(temp, std::ios::binary | std::ios::trunc);
+        if (ofs)
+        {
+            ofs.write((const char *)&h, sizeof(h));
+            ofs.write((const char *)blobs.data(), blobs.size());
+            ofs.write((const char *)index.data(), index.size() * sizeof(SPAWN_LIBRARY_ENTRY));
+            ofs.close();
+            written = !ofs.fail();
+        }
+    }
+
+    std::error_code ec;
+    if (written)
+        std::filesystem::rename(temp, path, ec);
+    if (!written || ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return -1;
+    }
+    return (int)index.size() - 1;
+}
+
+} // namespace Pt
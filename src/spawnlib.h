@@ -0,0 +1,70 @@
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <filesystem>
+
+#include "zlib.h"
+#include "spawn.h"
+#include "mapfile.h"
+
+namespace Pt
+{
+
+// 出怪列表库文件, 一个文件保存多个出怪列表
+// 头部 | 压缩后的列表[entry_count] | 索引[entry_count]
+// 索引放在最后并且带每波的数量统计, 映射之后按条件筛选不需要解压
+
+#define SPAWN_LIBRARY_MAGIC 0x4c535450 // "PTSL"
+#define SPAWN_LIBRARY_VERSION 1
+
+struct SPAWN_LIBRARY_HEADER
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+    uint64_t index_offset; // 索引在文件中的位置
+};
+
+struct SPAWN_LIBRARY_ENTRY
+{
+    uint64_t data_offset;       // 压缩后的 1000 个 int32
+    uint32_t data_size;         //
+    uint32_t crc;               // 解压后的 crc32
+    int64_t time;               // 保存时间, unix 时间戳
+    uint8_t histogram[33][20];  // 每种僵尸每波的数量
+    uint8_t reserved[4];        //
+};
+
+class SpawnLibrary
+{
+  public:
+    SpawnLibrary();
+    ~SpawnLibrary();
+
+    // 映射库文件, 不存在或者损坏时返回 false
+    bool Open(const std::filesystem::path &);
+    void Close();
+
+    size_t Count() const;
+    const SPAWN_LIBRARY_ENTRY &Entry(size_t) const;
+
+    // 解压第 i 个出怪列表, 校验失败时返回 false
+    bool List(size_t, std::array<int, 1000> &) const;
+
+    // 只用索引里的统计筛选, 返回符合全部约束的序号 (从小到大)
+    std::vector<size_t> Find(const std::vector<SPAWN_CONSTRAINT> &) const;
+
+    // 在库的末尾添加一个出怪列表, 文件不存在时新建, 返回添加后的序号, 失败返回 -1
+    static int Append(const std::filesystem::path &, const std::array<int, 1000> &, int64_t time);
+
+  private:
+    MappedFile file;
+    const SPAWN_LIBRARY_HEADER *header;
+    const SPAWN_LIBRARY_ENTRY *entries;
+};
+
+} // namespace Pt
@@ -34,6 +34,8 @@ Toolkit::Toolkit(int width, int height, const char *title)
 
     pak = new PAK();
 
+    manager = new ProcessManager();
+
     // 工作回调函数
     // Work callback function
 
@@ -113,6 +115,7 @@ Toolkit::Toolkit(int width, int height, const char *title)
     button_debug->callback(cb_debug_mode, this);
     button_speed->callback(cb_speed, this);
     check_limbo_page->callback(cb_limbo_page, this);
+    button_others_extra->callback(cb_sync_all_games, this);
 
     check_tooltips->callback(cb_tooltips, this); // 重载
 
@@ -121,10 +124,59 @@ Toolkit::Toolkit(int width, int height, const char *title)
 
 Toolkit::~Toolkit()
 {
+    this->spawn_cancel = true;
+    if (this->spawn_worker.joinable())
+        this->spawn_worker.join();
+
+    delete manager; // 先停止其他实例的工作线程
     delete pvz;
     delete pak;
 }
 
+void Toolkit::for_each_game(std::function<void(PvZ &)> func)
+{
+    if (sync_all_games && manager->Count() > 0)
+        manager->Broadcast(func);
+    else
+        func(*pvz);
+}
+
+void Toolkit::cb_sync_all_games(Fl_Widget *, void *w)
+{
+    ((Toolkit *)w)->cb_sync_all_games();
+}
+
+void Toolkit::cb_sync_all_games()
+{
+    button_others_extra->value(0);
+
+    if (sync_all_games)
+    {
+        sync_all_games = false;
+        manager->Clear();
+        button_others_extra->replace(0, EMOJI("✅", "[同步修改所有游戏]"));
+        return;
+    }
+
+    // 每个游戏窗口在自己的线程上连接, 当前连接的游戏也包括在内
+    size_t count = manager->FindAll();
+    if (count == 0)
+    {
+        fl_message_title("同步修改");
+        fl_alert("没有找到支持的游戏窗口.");
+        return;
+    }
+
+    sync_all_games = true;
+    button_others_extra->replace(0, EMOJI("❎", "[取消同步修改]"));
+
+    // 已经勾选的功能也应用到其他游戏上
+    keep_selected_feature();
+
+    fl_message_title("同步修改");
+    fl_message("已连接 %zu 个游戏窗口, 之后的修改会同步到所有窗口.", count);
+}
+
 void Toolkit::cb_tooltips(Fl_Widget *, void *w)
 {
     ((Toolkit *)w)->cb_tooltips();
@@ -195,6 +247,112 @@ void Toolkit::cb_zombies_list(Fl_Widget *, void *w)
 
 void Toolkit::cb_zombies_list()
 {
+    // 统计
+    int menu = window_spawn->button_zombies_list->value();
+    if (menu >= 3 && menu <= 5)
+    {
+        window_spawn->button_zombies_list->value(0);
+
+        // 自然出怪由游戏自己生成, 工具里没有和游戏逐个核对过的选波次算法, 不做统计
+        int spawn_mode = button_spawn_mode->value();
+        if (spawn_mode == 0)
+        {
+            fl_message_title("出怪统计");
+            fl_alert("自然出怪由游戏生成, 暂时只支持统计极限出怪和模拟出怪.");
+            return;
+        }
+        std::string title = spawn_mode == 1 ? "出怪统计 - 极限出怪" : "出怪统计 - 模拟出怪";
+
+        // 生成函数在界面线程里按当前设置创建, 后台线程只做计算
+        SpawnGenerator generator = spawn_generator();
+        auto seed = static_cast<uint32_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+        bool started = start_spawn_worker(
+            [this, generator, seed, menu, title]()
+            {
+                SPAWN_STATS stats = EstimateSpawnStats(generator, 10000, seed);
+                if (this->spawn_cancel)
+                    return;
+                this->spawn_stats_result = stats;
+                this->spawn_stats_view = menu - 3;
+                this->spawn_stats_title = title;
+                Fl::awake(cb_spawn_stats_done, this);
+            });
+        if (started)
+            window_spawn->copy_label((title + " - 计算中 ...").c_str());
+        return;
+    }
+
+    // 搜索符合约束条件的种子, 找到后写入游戏
+    if (menu == 6)
+    {
+        window_spawn->button_zombies_list->value(0);
+
+        // 自然出怪由游戏生成, 工具里没有和游戏一致的选波次算法可以搜索
+        if (button_spawn_mode->value() == 0)
+        {
+            fl_message_title("搜索出怪");
+            fl_alert("自然出怪由游戏生成, 暂时只支持搜索极限出怪和模拟出怪.");
+            return;
+        }
+
+        fl_message_title("搜索出怪");
+        const char *input = fl_input("约束条件, 如 \"32@1-9=0 8@20>=3\"\n"
+                                     "(前九波没有红眼, 第二十波至少三只舞王)",
+                                     window_spawn->spawn_constraints.c_str());
+        if (input == nullptr)
+            return;
+        window_spawn->spawn_constraints = input;
+
+        std::vector<SPAWN_CONSTRAINT> constraints;
+        if (!ParseSpawnConstraints(input, constraints))
+        {
+            fl_message_title("搜索出怪");
+            fl_alert("约束条件格式错误.");
+            return;
+        }
+
+        fl_message_title("搜索出怪");
+        input = fl_input("搜索的种子数量和列出的结果数量, 如 \"100000 5\"\n"
+                         "(种子数量 1 ~ 10000000, 结果数量 1 ~ 20)",
+                         window_spawn->spawn_search.c_str());
+        if (input == nullptr)
+            return;
+        window_spawn->spawn_search = input;
+
+        // 两个数字用空格分开
+        size_t count = 0, top_k = 0;
+        std::string_view text = input;
+        size_t space = text.find(' ');
+        std::string_view text_count = text.substr(0, space);
+        std::string_view text_top_k = space == std::string_view::npos ? "" : text.substr(space + 1);
+        auto [p1, ec1] = std::from_chars(text_count.data(), text_count.data() + text_count.size(), count);
+        auto [p2, ec2] = std::from_chars(text_top_k.data(), text_top_k.data() + text_top_k.size(), top_k);
+        if (ec1 != std::errc() || p1 != text_count.data() + text_count.size() //
+            || ec2 != std::errc() || p2 != text_top_k.data() + text_top_k.size()
+            || count < 1 || count > 10000000 || top_k < 1 || top_k > 20)
+        {
+            fl_message_title("搜索出怪");
+            fl_alert("种子数量或者结果数量错误.");
+            return;
+        }
+
+        SpawnGenerator generator = spawn_generator();
+        auto seed = static_cast<uint32_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+        bool started = start_spawn_worker(
+            [this, generator, constraints, seed, count, top_k]()
+            {
+                auto results = SearchSpawnSeeds(generator, constraints, seed, count, top_k, false, 0, &this->spawn_cancel);
+                if (this->spawn_cancel)
+                    return;
+                this->spawn_search_generator = generator;
+                this->spawn_search_result = results;
+                Fl::awake(cb_spawn_search_done, this);
+            });
+        if (started)
+            window_spawn->copy_label("搜索出怪 - 计算中 ...");
+        return;
+    }
+
     // 加载
     bool import_success = false;
     if (window_spawn->button_zombies_list->value() == 2)
@@ -204,7 +362,7 @@ void Toolkit::cb_zombies_list()
         ZeroMemory(&ofn, sizeof(ofn));
         ofn.lStructSize = sizeof(ofn);
         ofn.hwndOwner = nullptr;
-        ofn.lpstrFilter = L"*.zbl\0*.zbl\0";
+        ofn.lpstrFilter = L"*.zbs;*.zbl\0*.zbs;*.zbl\0";
         ofn.nFilterIndex = 1;
         ofn.lpstrFile = szFileName;
         ofn.lpstrFile[0] = '\0';
@@ -218,8 +376,51 @@ void Toolkit::cb_zombies_list()
 #ifdef _DEBUG
             std::wcout << L"打开文件: " << std::wstring(szFileName) << std::endl;
 #endif
+            SpawnLibrary library;
+            if (library.Open(szFileName) && library.Count() > 0)
+            {
+                // 输入序号或者约束条件, 约束条件取符合的最后一个
+                fl_message_title("加载");
+                std::string hint = "序号 (0 ~ " + std::to_string(library.Count() - 1) + ") 或者约束条件:";
+                const char *input = fl_input("%s", std::to_string(library.Count() - 1).c_str(), hint.c_str());
+                if (input != nullptr)
+                {
+                    std::string text = input;
+                    int index = -1;
+                    if (!text.empty() && text.find_first_not_of("0123456789") == std::string::npos)
+                    {
+                        // 超出 int 范围时 index 保持 -1, 按无效序号处理
+                        std::from_chars(text.data(), text.data() + text.size(), index);
+                    }
+                    else
+                    {
+                        std::vector<SPAWN_CONSTRAINT> constraints;
+                        if (ParseSpawnConstraints(text, constraints))
+                        {
+                            auto found = library.Find(constraints);
+                            if (!found.empty())
+                                index = (int)found.back();
+                        }
+                    }
+
+                    std::array<int, 1000> zl;
+                    if (index >= 0 && index < (int)library.Count() && library.List(index, zl))
+                    {
+                        pvz->SetSpawnList(zl);
+                        import_success = true;
+                    }
+                    else
+                    {
+                        fl_message_title("加载");
+                        fl_alert("序号超出范围, 或者没有符合条件的出怪列表.");
+                    }
+                }
+                library.Close();
+            }
+
+            // 旧格式, 一个文件一个列表
             auto size = std::filesystem::file_size(szFileName);
-            if (size == (1 + 1 + 1 + 1000 + 1) * sizeof(int))
+            if (!import_success && size == (1 + 1 + 1 + 1000 + 1) * sizeof(int))
             {
                 std::ifstream infile;
                 infile.open(szFileName, std::ios::binary | std::ios::in);
@@ -278,6 +479,7 @@ void Toolkit::cb_zombies_list()
         }
     }
 
+    window_spawn->copy_label("");
     window_spawn->UpdateData(zombies_list);
 
     if (window_spawn->button_zombies_list->value() == 2 && import_success)
@@ -286,56 +488,166 @@ void Toolkit::cb_zombies_list()
         fl_message("出怪列表已经导入到游戏中.");
     }
 
-    // 保存
+    // 保存, 添加到出怪列表库的末尾
     if (window_spawn->button_zombies_list->value() == 1)
     {
-        int data[1 + 1 + 1 + 1000 + 1] = {0};
-
-        data[0] = 0x58434c52; // header
-        data[1] = 1;          // version
-        data[2] = 1000;       // length
-
-        for (size_t i = 0; i < 1000; i++)
-            data[3 + i] = zombies_list[i];
-
-        unsigned long crc = crc32(0L, Z_NULL, 0);
-        crc = crc32(crc, (const unsigned char *)data, (3 + 1000) * sizeof(int));
-        data[3 + 1000] = crc;
-
         std::filesystem::current_path(this->path);
         system("mkdir zombies");
 
-        SYSTEMTIME time_now;
-        GetLocalTime(&time_now);
-        std::string filename = std::string("zombies")             //
-                               + "\\"                             //
-                               + std::to_string(time_now.wYear)   //
-                               + "."                              //
-                               + std::to_string(time_now.wMonth)  //
-                               + "."                              //
-                               + std::to_string(time_now.wDay)    //
-                               + "_"                              //
-                               + std::to_string(time_now.wHour)   //
-                               + "."                              //
-                               + std::to_string(time_now.wMinute) //
-                               + "."                              //
-                               + std::to_string(time_now.wSecond) //
-                               + ".zbl";                          //
-
-        std::ofstream outfile;
-        outfile.open(filename.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
-        if (outfile)
+        std::string filename = std::string("zombies") + "\\" + "spawn.zbs";
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        int index = SpawnLibrary::Append(filename, zombies_list, //
+                                         std::chrono::duration_cast<std::chrono::seconds>(now).count());
+        if (index >= 0)
         {
-            outfile.write(reinterpret_cast<char *>(&data), sizeof(data));
             fl_message_title("保存成功");
-            fl_message(std::string("当前出怪列表保存在文件: \n" + filename).c_str());
+            fl_message("%s", std::string("当前出怪列表保存在文件: \n" + filename + " (序号 " //
+                                         + std::to_string(index) + ")")
+                                 .c_str());
+        }
+        else
+        {
+            fl_message_title("保存失败");
+            fl_alert("%s", std::string("无法写入文件: \n" + filename).c_str());
         }
-        outfile.close();
     }
 
     window_spawn->button_zombies_list->value(0);
 }
 
+bool Toolkit::start_spawn_worker(std::function<void()> func)
+{
+    if (this->spawn_working)
+    {
+        fl_message_title("出怪统计");
+        if (fl_choice("正在后台计算, 要取消吗?", "继续等待", "取消计算", nullptr) == 1)
+            this->spawn_cancel = true;
+        return false;
+    }
+
+    if (this->spawn_worker.joinable())
+        this->spawn_worker.join();
+    this->spawn_cancel = false;
+    this->spawn_working = true;
+    this->spawn_worker = std::thread(
+        [this, func]()
+        {
+            func();
+            this->spawn_working = false;
+        });
+    return true;
+}
+
+void Toolkit::cb_spawn_stats_done(void *w)
+{
+    ((Toolkit *)w)->cb_spawn_stats_done();
+}
+
+void Toolkit::cb_spawn_stats_done()
+{
+    window_spawn->copy_label(spawn_stats_title.c_str());
+    window_spawn->UpdateData(spawn_stats_result, spawn_stats_view);
+}
+
+void Toolkit::cb_spawn_search_done(void *w)
+{
+    ((Toolkit *)w)->cb_spawn_search_done();
+}
+
+void Toolkit::cb_spawn_search_done()
+{
+    window_spawn->copy_label("");
+    if (spawn_search_result.empty())
+        return;
+
+    SPAWN_SEARCH_RESULT best = spawn_search_result[0];
+    std::array<int, 1000> zombies_list = spawn_search_generator(best.seed);
+    window_spawn->UpdateData(zombies_list);
+
+    // 找到的列表总是显示出来, 只有条件满足时才写入游戏
+    std::string reason;
+    bool writable = spawn_list_writable(reason);
+    if (writable)
+        pvz->SetSpawnList(zombies_list);
+
+    std::string text = best.distance == 0
+                           ? "找到符合条件的出怪列表 (种子 " + std::to_string(best.seed) + ")"
+                           : "没有完全符合条件的出怪列表, 最接近的一个为 (种子 " + std::to_string(best.seed) //
+                                 + ", 差距 " + std::to_string(best.distance) + ")";
+    text += writable ? ", 已经写入游戏." : ", 但是" + reason + ", 没有写入游戏.";
+
+    // 其余的结果只列出来, 按差距从小到大
+    if (spawn_search_result.size() > 1)
+    {
+        text += "\n\n其他结果:";
+        for (size_t i = 1; i < spawn_search_result.size(); i++)
+            text += "\n种子 " + std::to_string(spawn_search_result[i].seed) //
+                    + ", 差距 " + std::to_string(spawn_search_result[i].distance);
+    }
+
+    fl_message_title("搜索出怪");
+    if (writable)
+        fl_message("%s", text.c_str());
+    else
+        fl_alert("%s", text.c_str());
+}
+
+bool Toolkit::spawn_list_writable(std::string &reason)
+{
+    if (!pvz->GameOn())
+    {
+        reason = "没有找到游戏";
+        return false;
+    }
+    int game_ui = pvz->GameUI();
+    if (game_ui != 2 && game_ui != 3)
+    {
+        reason = "游戏不在选卡或者战斗界面";
+        return false;
+    }
+    int game_mode = pvz->GameMode();
+    if (game_mode < 1 || game_mode > 15)
+    {
+        reason = "当前不是生存模式";
+        return false;
+    }
+    return true;
+}
+
+std::array<bool, 33> Toolkit::selected_spawn_types(int spawn_mode)
+{
+    std::array<bool, 33> zombies = {false};
+    for (size_t i = 0; i < 20; i++)
+        zombies[spawn_type[i]] = (check_zombie[i]->value() == 1);
+    zombies[0] = true;
+    if (spawn_mode != 0)
+        zombies[1] = true;
+    return zombies;
+}
+
+SpawnGenerator Toolkit::spawn_generator()
+{
+    int spawn_mode = button_spawn_mode->value();
+    std::array<bool, 33> zombies = selected_spawn_types(spawn_mode);
+    int giga_weight = 1000 + 100 * choice_giga_weight->value();
+    bool limit_giga = check_giga_limit->value() == 1;
+
+    switch (spawn_mode)
+    {
+    case 0: // 自然, 由游戏生成, 工具里没有对应的生成函数
+        return nullptr;
+
+    case 1: // 极限
+    default:
+        return [zombies, limit_giga](uint32_t seed)
+        { return GenerateSpawnList(zombies, limit_giga, false, 1000, seed); };
+
+    case 2: // 模拟
+        return [zombies, limit_giga, giga_weight](uint32_t seed)
+        { return GenerateSpawnList(zombies, limit_giga, true, giga_weight, seed); };
+    }
+}
+
 void Toolkit::cb_on_hide_spawn_details(Fl_Widget *, void *w)
 {
     ((Toolkit *)w)->cb_on_hide_spawn_details();
@@ -343,6 +655,8 @@ void Toolkit::cb_on_hide_spawn_details(Fl_Widget *, void *w)
 
 void Toolkit::cb_on_hide_spawn_details()
 {
+    // 关闭窗口时放弃正在计算的统计
+    this->spawn_cancel = true;
     window_spawn->hide();
 
     cb_tooltips();
@@ -361,7 +675,9 @@ void Toolkit::cb_unlock_sun_limit(Fl_Widget *, void *w)
 
 void Toolkit::cb_unlock_sun_limit()
 {
-    pvz->UnlockSunLimit(check_unlock_sun_limit->value());
+    bool on = check_unlock_sun_limit->value();
+    for_each_game([=](PvZ &p)
+                  { p.UnlockSunLimit(on); });
 }
 
 void Toolkit::cb_set_sun(Fl_Widget *, void *w)
@@ -371,7 +687,9 @@ void Toolkit::cb_set_sun(Fl_Widget *, void *w)
 
 void Toolkit::cb_set_sun()
 {
-    pvz->SetSun(static_cast<int>(input_sun->value()));
+    int sun = static_cast<int>(input_sun->value());
+    for_each_game([=](PvZ &p)
+                  { p.SetSun(sun); });
 }
 
 void Toolkit::cb_set_money(Fl_Widget *, void *w)
@@ -381,7 +699,9 @@ void Toolkit::cb_set_money(Fl_Widget *, void *w)
 
 void Toolkit::cb_set_money()
 {
-    pvz->SetMoney(static_cast<int>(input_money->value()));
+    int money = static_cast<int>(input_money->value());
+    for_each_game([=](PvZ &p)
+                  { p.SetMoney(money); });
 }
 
 void Toolkit::cb_auto_collected(Fl_Widget *, void *w)
@@ -391,7 +711,9 @@ void Toolkit::cb_auto_collected(Fl_Widget *, void *w)
 
 void Toolkit::cb_auto_collected()
 {
-    pvz->AutoCollected(check_auto_collected->value());
+    bool on = check_auto_collected->value();
+    for_each_game([=](PvZ &p)
+                  { p.AutoCollected(on); });
 }
 
 void Toolkit::cb_not_drop_loot(Fl_Widget *, void *w)
@@ -401,7 +723,9 @@ void Toolkit::cb_not_drop_loot(Fl_Widget *, void *w)
 
 void Toolkit::cb_not_drop_loot()
 {
-    pvz->NotDropLoot(check_not_drop_loot->value());
+    bool on = check_not_drop_loot->value();
+    for_each_game([=](PvZ &p)
+                  { p.NotDropLoot(on); });
 }
 
 void Toolkit::cb_fertilizer(Fl_Widget *, void *w)
@@ -411,7 +735,9 @@ void Toolkit::cb_fertilizer(Fl_Widget *, void *w)
 
 void Toolkit::cb_fertilizer()
 {
-    pvz->FertilizerUnlimited(check_fertilizer->value());
+    bool on = check_fertilizer->value();
+    for_each_game([=](PvZ &p)
+                  { p.FertilizerUnlimited(on); });
 }
 
 void Toolkit::cb_bug_spray(Fl_Widget *, void *w)
@@ -421,7 +747,9 @@ void Toolkit::cb_bug_spray(Fl_Widget *, void *w)
 
 void Toolkit::cb_bug_spray()
 {
-    pvz->BugSprayUnlimited(check_bug_spray->value());
+    bool on = check_bug_spray->value();
+    for_each_game([=](PvZ &p)
+                  { p.BugSprayUnlimited(on); });
 }
 
 void Toolkit::cb_tree_food(Fl_Widget *, void *w)
@@ -431,7 +759,9 @@ void Toolkit::cb_tree_food(Fl_Widget *, void *w)
 
 void Toolkit::cb_tree_food()
 {
-    pvz->TreeFoodUnlimited(check_tree_food->value());
+    bool on = check_tree_food->value();
+    for_each_game([=](PvZ &p)
+                  { p.TreeFoodUnlimited(on); });
 }
 
 void Toolkit::cb_chocolate(Fl_Widget *, void *w)
@@ -441,7 +771,9 @@ void Toolkit::cb_chocolate(Fl_Widget *, void *w)
 
 void Toolkit::cb_chocolate()
 {
-    pvz->ChocolateUnlimited(check_chocolate->value());
+    bool on = check_chocolate->value();
+    for_each_game([=](PvZ &p)
+                  { p.ChocolateUnlimited(on); });
 }
 
 void Toolkit::cb_wisdom_tree(Fl_Widget *, void *w)
@@ -451,7 +783,9 @@ void Toolkit::cb_wisdom_tree(Fl_Widget *, void *w)
 
 void Toolkit::cb_wisdom_tree()
 {
-    pvz->SetTreeHeight(static_cast<int>(input_wisdom_tree->value()));
+    int height = static_cast<int>(input_wisdom_tree->value());
+    for_each_game([=](PvZ &p)
+                  { p.SetTreeHeight(height); });
 }
 
 void Toolkit::cb_free_planting(Fl_Widget *, void *w)
@@ -461,7 +795,9 @@ void Toolkit::cb_free_planting(Fl_Widget *, void *w)
 
 void Toolkit::cb_free_planting()
 {
-    pvz->FreePlanting(check_free_planting->value());
+    bool on = check_free_planting->value();
+    for_each_game([=](PvZ &p)
+                  { p.FreePlanting(on); });
 }
 
 void Toolkit::cb_placed_anywhere(Fl_Widget *, void *w)
@@ -471,7 +807,9 @@ void Toolkit::cb_placed_anywhere(Fl_Widget *, void *w)
 
 void Toolkit::cb_placed_anywhere()
 {
-    pvz->PlacedAnywhere(check_placed_anywhere->value());
+    bool on = check_placed_anywhere->value();
+    for_each_game([=](PvZ &p)
+                  { p.PlacedAnywhere(on); });
 }
 
 void Toolkit::cb_fast_belt(Fl_Widget *, void *w)
@@ -481,7 +819,9 @@ void Toolkit::cb_fast_belt(Fl_Widget *, void *w)
 
 void Toolkit::cb_fast_belt()
 {
-    pvz->FastBelt(check_fast_belt->value());
+    bool on = check_fast_belt->value();
+    for_each_game([=](PvZ &p)
+                  { p.FastBelt(on); });
 }
 
 void Toolkit::cb_lock_shovel(Fl_Widget *, void *w)
@@ -491,7 +831,9 @@ void Toolkit::cb_lock_shovel(Fl_Widget *, void *w)
 
 void Toolkit::cb_lock_shovel()
 {
-    pvz->LockShovel(check_lock_shovel->value());
+    bool on = check_lock_shovel->value();
+    for_each_game([=](PvZ &p)
+                  { p.LockShovel(on); });
 }
 
 void Toolkit::cb_mix_mode(Fl_Widget *, void *w)
@@ -507,7 +849,8 @@ void Toolkit::cb_mix_mode()
     if (mode == 0) // 冒险模式
         level++;
 
-    pvz->MixMode(mode, level);
+    for_each_game([=](PvZ &p)
+                  { p.MixMode(mode, level); });
 }
 
 void Toolkit::cb_endless_rounds(Fl_Widget *, void *w)
@@ -517,7 +860,9 @@ void Toolkit::cb_endless_rounds(Fl_Widget *, void *w)
 
 void Toolkit::cb_endless_rounds()
 {
-    pvz->EndlessRounds(static_cast<int>(input_level->value()));
+    int rounds = static_cast<int>(input_level->value());
+    for_each_game([=](PvZ &p)
+                  { p.EndlessRounds(rounds); });
 }
 
 void Toolkit::cb_unlock(Fl_Widget *, void *w)
@@ -527,7 +872,8 @@ void Toolkit::cb_unlock(Fl_Widget *, void *w)
 
 void Toolkit::cb_unlock()
 {
-    pvz->UnlockTrophy();
+    for_each_game([](PvZ &p)
+                  { p.UnlockTrophy(); });
 }
 
 void Toolkit::cb_direct_win(Fl_Widget *, void *w)
@@ -587,7 +933,8 @@ void Toolkit::cb_put_plant()
     int col = choice_col->value() - 1;
     int type = choice_plant->value();
     bool imitater = check_imitater->value();
-    pvz->PutPlant(row, col, type, imitater);
+    for_each_game([=](PvZ &p)
+                  { p.PutPlant(row, col, type, imitater); });
 }
 
 // Finding out what this calls?
@@ -604,7 +951,8 @@ void Toolkit::cb_put_zombie()
     int row = choice_row->value() - 1;
     int col = choice_col->value() - 1;
     int type = choice_zombie->value();
-    pvz->PutZombie(row, col, type);
+    for_each_game([=](PvZ &p)
+                  { p.PutZombie(row, col, type); });
 }
 
 void Toolkit::cb_put_ladder(Fl_Widget *, void *w)
@@ -616,7 +964,8 @@ void Toolkit::cb_put_ladder()
 {
     int row = choice_row->value() - 1;
     int col = choice_col->value() - 1;
-    pvz->PutLadder(row, col);
+    for_each_game([=](PvZ &p)
+                  { p.PutLadder(row, col); });
 }
 
 void Toolkit::cb_put_grave(Fl_Widget *, void *w)
@@ -628,7 +977,8 @@ void Toolkit::cb_put_grave()
 {
     int row = choice_row->value() - 1;
     int col = choice_col->value() - 1;
-    pvz->PutGrave(row, col);
+    for_each_game([=](PvZ &p)
+                  { p.PutGrave(row, col); });
 }
 
 void Toolkit::cb_put_rake(Fl_Widget *, void *w)
@@ -640,7 +990,8 @@ void Toolkit::cb_put_rake()
 {
     int row = choice_row->value() - 1;
     int col = choice_col->value() - 1;
-    pvz->PutRake(row, col);
+    for_each_game([=](PvZ &p)
+                  { p.PutRake(row, col); });
 }
 
 void Toolkit::cb_lawn_mower(Fl_Widget *, void *w)
@@ -650,7 +1001,9 @@ void Toolkit::cb_lawn_mower(Fl_Widget *, void *w)
 
 void Toolkit::cb_lawn_mower()
 {
-    pvz->SetLawnMowers(button_lawn_mower->value());
+    int mode = button_lawn_mower->value();
+    for_each_game([=](PvZ &p)
+                  { p.SetLawnMowers(mode); });
 }
 
 void Toolkit::cb_clear(Fl_Widget *, void *w)
@@ -663,19 +1016,24 @@ void Toolkit::cb_clear()
     switch (choice_item->value())
     {
     case 0: // 植物
-        pvz->ClearAllPlants();
+        for_each_game([](PvZ &p)
+                      { p.ClearAllPlants(); });
         break;
     case 1: // 僵尸
-        pvz->KillAllZombies();
+        for_each_game([](PvZ &p)
+                      { p.KillAllZombies(); });
         break;
     case 2: // 梯子
-        pvz->ClearGridItems({3});
+        for_each_game([](PvZ &p)
+                      { p.ClearGridItems({3}); });
         break;
     case 3: // 墓碑
-        pvz->ClearGridItems({1});
+        for_each_game([](PvZ &p)
+                      { p.ClearGridItems({1}); });
         break;
     case 4: // 钉耙
-        pvz->ClearGridItems({11});
+        for_each_game([](PvZ &p)
+                      { p.ClearGridItems({11}); });
         break;
     default:
         break;
@@ -692,8 +1050,12 @@ void Toolkit::cb_plant_invincible()
     if (check_plant_weak->value())
         check_plant_weak->value(0);
 
-    pvz->PlantWeak(false);
-    pvz->PlantInvincible(check_plant_invincible->value());
+    bool on = check_plant_invincible->value();
+    for_each_game([=](PvZ &p)
+                  {
+                      p.PlantWeak(false);
+                      p.PlantInvincible(on);
+                  });
 }
 
 void Toolkit::cb_plant_weak(Fl_Widget *, void *w)
@@ -706,8 +1068,12 @@ void Toolkit::cb_plant_weak()
     if (check_plant_invincible->value())
         check_plant_invincible->value(0);
 
-    pvz->PlantInvincible(false);
-    pvz->PlantWeak(check_plant_weak->value());
+    bool on = check_plant_weak->value();
+    for_each_game([=](PvZ &p)
+                  {
+                      p.PlantInvincible(false);
+                      p.PlantWeak(on);
+                  });
 }
 
 void Toolkit::cb_zombie_invincible(Fl_Widget *, void *w)
@@ -720,8 +1086,12 @@ void Toolkit::cb_zombie_invincible()
     if (check_zombie_weak->value())
         check_zombie_weak->value(0);
 
-    pvz->ZombieWeak(false);
-    pvz->ZombieInvincible(check_zombie_invincible->value());
+    bool on = check_zombie_invincible->value();
+    for_each_game([=](PvZ &p)
+                  {
+                      p.ZombieWeak(false);
+                      p.ZombieInvincible(on);
+                  });
 }
 
 void Toolkit::cb_zombie_weak(Fl_Widget *, void *w)
@@ -734,8 +1104,12 @@ void Toolkit::cb_zombie_weak()
     if (check_zombie_invincible->value())
         check_zombie_invincible->value(0);
 
-    pvz->ZombieInvincible(false);
-    pvz->ZombieWeak(check_zombie_weak->value());
+    bool on = check_zombie_weak->value();
+    for_each_game([=](PvZ &p)
+                  {
+                      p.ZombieInvincible(false);
+                      p.ZombieWeak(on);
+                  });
 }
 
 void Toolkit::cb_reload_instantly(Fl_Widget *, void *w)
@@ -745,7 +1119,9 @@ void Toolkit::cb_reload_instantly(Fl_Widget *, void *w)
 
 void Toolkit::cb_reload_instantly()
 {
-    pvz->ReloadInstantly(check_reload_instantly->value());
+    bool on = check_reload_instantly->value();
+    for_each_game([=](PvZ &p)
+                  { p.ReloadInstantly(on); });
 }
 
 void Toolkit::cb_mushroom_awake(Fl_Widget *, void *w)
@@ -755,7 +1131,9 @@ void Toolkit::cb_mushroom_awake(Fl_Widget *, void *w)
 
 void Toolkit::cb_mushroom_awake()
 {
-    pvz->MushroomsAwake(check_mushroom_awake->value());
+    bool on = check_mushroom_awake->value();
+    for_each_game([=](PvZ &p)
+                  { p.MushroomsAwake(on); });
 }
 
 void Toolkit::cb_stop_spawning(Fl_Widget *, void *w)
@@ -765,7 +1143,9 @@ void Toolkit::cb_stop_spawning(Fl_Widget *, void *w)
 
 void Toolkit::cb_stop_spawning()
 {
-    pvz->StopSpawning(check_stop_spawning->value());
+    bool on = check_stop_spawning->value();
+    for_each_game([=](PvZ &p)
+                  { p.StopSpawning(on); });
 }
 
 void Toolkit::cb_stop_zombies(Fl_Widget *, void *w)
@@ -775,7 +1155,9 @@ void Toolkit::cb_stop_zombies(Fl_Widget *, void *w)
 
 void Toolkit::cb_stop_zombies()
 {
-    pvz->StopZombies(check_stop_zombies->value());
+    bool on = check_stop_zombies->value();
+    for_each_game([=](PvZ &p)
+                  { p.StopZombies(on); });
 }
 
 void Toolkit::cb_lock_butter(Fl_Widget *, void *w)
@@ -785,7 +1167,9 @@ void Toolkit::cb_lock_butter(Fl_Widget *, void *w)
 
 void Toolkit::cb_lock_butter()
 {
-    pvz->LockButter(check_lock_butter->value());
+    bool on = check_lock_butter->value();
+    for_each_game([=](PvZ &p)
+                  { p.LockButter(on); });
 }
 
 void Toolkit::cb_no_crater(Fl_Widget *, void *w)
@@ -795,7 +1179,9 @@ void Toolkit::cb_no_crater(Fl_Widget *, void *w)
 
 void Toolkit::cb_no_crater()
 {
-    pvz->NoCrater(check_no_crater->value());
+    bool on = check_no_crater->value();
+    for_each_game([=](PvZ &p)
+                  { p.NoCrater(on); });
 }
 
 void Toolkit::cb_no_ice_trail(Fl_Widget *, void *w)
@@ -805,7 +1191,9 @@ void Toolkit::cb_no_ice_trail(Fl_Widget *, void *w)
 
 void Toolkit::cb_no_ice_trail()
 {
-    pvz->NoIceTrail(check_no_ice_trail->value());
+    bool on = check_no_ice_trail->value();
+    for_each_game([=](PvZ &p)
+                  { p.NoIceTrail(on); });
 }
 
 void Toolkit::cb_zombie_not_explode(Fl_Widget *, void *w)
@@ -815,7 +1203,9 @@ void Toolkit::cb_zombie_not_explode(Fl_Widget *, void *w)
 
 void Toolkit::cb_zombie_not_explode()
 {
-    pvz->ZombieNotExplode(check_zombie_not_explode->value());
+    bool on = check_zombie_not_explode->value();
+    for_each_game([=](PvZ &p)
+                  { p.ZombieNotExplode(on); });
 }
 
 void Toolkit::cb_get_seed(Fl_Widget *, void *w)
@@ -857,7 +1247,8 @@ void Toolkit::cb_set_seed()
     int seed_type = choice_seed->value();
     bool is_imitater = check_seed_imitater->value();
 
-    pvz->SetSlotSeed(index, seed_type, is_imitater);
+    for_each_game([=](PvZ &p)
+                  { p.SetSlotSeed(index, seed_type, is_imitater); });
 }
 
 void Toolkit::cb_lineup_mode(Fl_Widget *, void *w)
@@ -915,7 +1306,8 @@ void Toolkit::cb_auto_ladder(Fl_Widget *, void *w)
 
 void Toolkit::cb_auto_ladder()
 {
-    pvz->AutoLadder(true);
+    for_each_game([](PvZ &p)
+                  { p.AutoLadder(true); });
 }
 
 void Toolkit::cb_put_lily_pad(Fl_Widget *, void *w)
@@ -930,7 +1322,8 @@ void Toolkit::cb_put_lily_pad()
         return;
     int from_col = lily_pad_col_lower[i];
     int to_col = lily_pad_col_upper[i];
-    pvz->LilyPadOnPool(from_col, to_col);
+    for_each_game([=](PvZ &p)
+                  { p.LilyPadOnPool(from_col, to_col); });
 }
 
 void Toolkit::cb_put_flower_pot(Fl_Widget *, void *w)
@@ -945,7 +1338,8 @@ void Toolkit::cb_put_flower_pot()
         return;
     int from_col = flower_pot_col_lower[i];
     int to_col = flower_pot_col_upper[i];
-    pvz->FlowerPotOnRoof(from_col, to_col);
+    for_each_game([=](PvZ &p)
+                  { p.FlowerPotOnRoof(from_col, to_col); });
 }
 
 void Toolkit::cb_reset_scene(Fl_Widget *, void *w)
@@ -955,7 +1349,9 @@ void Toolkit::cb_reset_scene(Fl_Widget *, void *w)
 
 void Toolkit::cb_reset_scene()
 {
-    pvz->SetScene(choice_scene->value(), true);
+    int scene = choice_scene->value();
+    for_each_game([=](PvZ &p)
+                  { p.SetScene(scene, true); });
 }
 
 void Toolkit::cb_get_lineup(Fl_Widget *, void *w)
@@ -968,6 +1364,22 @@ void Toolkit::cb_get_lineup()
     Lineup lineup = pvz->GetLineup();
     std::string str = lineup.Generate();
     buffer_lineup_string->text(str.c_str());
+
+    // 阵型列表里有相同的阵型时选中它, 没有的话选中最接近的
+    size_t index = lineup_index.Find(lineup);
+    if (index == LINEUP_NOT_FOUND)
+    {
+        std::vector<LINEUP_MATCH> matches = lineup_search.Nearest(lineup, 1);
+        if (!matches.empty())
+            index = matches[0].id;
+    }
+    if (index != LINEUP_NOT_FOUND && lineup.scene < 6)
+    {
+        auto &order = lineup_order[lineup.scene];
+        auto it = std::find(order.begin(), order.end(), index);
+        if (it != order.end())
+            choice_lineup_name[lineup.scene]->value(int(it - order.begin()));
+    }
 }
 
 void Toolkit::cb_set_lineup(Fl_Widget *, void *w)
@@ -997,7 +1409,8 @@ void Toolkit::cb_set_lineup()
     }
 
     Lineup lineup(str);
-    pvz->SetLineup(lineup);
+    for_each_game([=](PvZ &p)
+                  { p.SetLineup(lineup, true); });
 }
 
 void Toolkit::cb_capture(Fl_Widget *, void *w)
@@ -1030,29 +1443,22 @@ void Toolkit::cb_set_spawn()
     if ((game_mode < 1 || game_mode > 15) && spawn_mode != 0)
         return;
 
-    std::array<bool, 33> zombies = {false};
-    for (size_t i = 0; i < 20; i++)
-        zombies[spawn_type[i]] = (check_zombie[i]->value() == 1);
+    std::array<bool, 33> zombies = selected_spawn_types(spawn_mode);
     int giga_weight = 1000 + 100 * choice_giga_weight->value();
     bool limit_giga = check_giga_limit->value() == 1;
 
     switch (spawn_mode)
     {
     case 0: // 自然
-        zombies[0] = true;
         pvz->InternalSpawn(zombies);
         break;
 
     case 1: // 极限
     default:
-        zombies[0] = true;
-        zombies[1] = true;
         pvz->CustomizeSpawn(zombies, limit_giga, false, 1000);
         break;
 
     case 2: // 模拟
-        zombies[0] = true;
-        zombies[1] = true;
         pvz->CustomizeSpawn(zombies, limit_giga, true, giga_weight);
         break;
     }
@@ -1068,7 +1474,9 @@ void Toolkit::cb_music(Fl_Widget *, void *w)
 
 void Toolkit::cb_music()
 {
-    pvz->SetMusic(choice_music->value() + 1);
+    int music_id = choice_music->value() + 1;
+    for_each_game([=](PvZ &p)
+                  { p.SetMusic(music_id); });
 }
 
 void Toolkit::cb_userdata(Fl_Widget *, void *w)
@@ -1156,7 +1564,9 @@ void Toolkit::cb_no_fog(Fl_Widget *, void *w)
 
 void Toolkit::cb_no_fog()
 {
-    pvz->NoFog(check_no_fog->value());
+    bool on = check_no_fog->value();
+    for_each_game([=](PvZ &p)
+                  { p.NoFog(on); });
 }
 
 void Toolkit::cb_see_vase(Fl_Widget *, void *w)
@@ -1166,7 +1576,9 @@ void Toolkit::cb_see_vase(Fl_Widget *, void *w)
 
 void Toolkit::cb_see_vase()
 {
-    pvz->SeeVase(check_see_vase->value());
+    bool on = check_see_vase->value();
+    for_each_game([=](PvZ &p)
+                  { p.SeeVase(on); });
 }
 
 void Toolkit::cb_background(Fl_Widget *, void *w)
@@ -1176,7 +1588,9 @@ void Toolkit::cb_background(Fl_Widget *, void *w)
 
 void Toolkit::cb_background()
 {
-    pvz->BackgroundRunning(check_background->value());
+    bool on = check_background->value();
+    for_each_game([=](PvZ &p)
+                  { p.BackgroundRunning(on); });
 }
 
 void Toolkit::cb_readonly(Fl_Widget *, void *w)
@@ -1186,7 +1600,9 @@ void Toolkit::cb_readonly(Fl_Widget *, void *w)
 
 void Toolkit::cb_readonly()
 {
-    pvz->UserdataReadonly(check_readonly->value());
+    bool on = check_readonly->value();
+    for_each_game([=](PvZ &p)
+                  { p.UserdataReadonly(on); });
 }
 
 void Toolkit::cb_unpack(Fl_Widget *, void *w)
@@ -1287,6 +1703,17 @@ void Toolkit::cb_unpack_thread()
             break;
         }
     }
+
+    // 列出失败的文件, 最多显示前几个
+    const auto &errors = pak->UnpackErrors();
+    if (!errors.empty())
+    {
+        this->unpack_text += "\n\n失败的文件 (" + std::to_string(errors.size()) + " 个)：";
+        for (size_t i = 0; i < errors.size() && i < 5; i++)
+            this->unpack_text += "\n" + errors[i].name;
+        if (errors.size() > 5)
+            this->unpack_text += "\n...";
+    }
 }
 
 void Toolkit::cb_pack(Fl_Widget *, void *w)
@@ -1353,7 +1780,9 @@ void Toolkit::cb_pack_thread()
     Fl::unlock();
     Fl::awake();
 
-    int ret = pak->Pack(src_dir, dst_file);
+    // 解包用的 pak 文件作为增量打包的参考, 没有修改的文件直接沿用
+    std::string base_file = std::string(input_file->value());
+    int ret = pak->Pack(src_dir, dst_file, base_file);
 
     Fl::lock();
     button_file->activate();
@@ -1395,7 +1824,9 @@ void Toolkit::cb_debug_mode(Fl_Widget *, void *w)
 
 void Toolkit::cb_debug_mode()
 {
-    pvz->DebugMode(choice_debug->value());
+    int mode = choice_debug->value();
+    for_each_game([=](PvZ &p)
+                  { p.DebugMode(mode); });
 }
 
 void Toolkit::cb_speed(Fl_Widget *, void *w)
@@ -1414,7 +1845,9 @@ void Toolkit::cb_speed()
         50,  // 0.2x
         100, // 0.1x
     };
-    pvz->SetFrameDuration(time_ms[choice_speed->value()]);
+    int frame_duration = time_ms[choice_speed->value()];
+    for_each_game([=](PvZ &p)
+                  { p.SetFrameDuration(frame_duration); });
 }
 
 void Toolkit::cb_limbo_page(Fl_Widget *, void *w)
@@ -1424,7 +1857,9 @@ void Toolkit::cb_limbo_page(Fl_Widget *, void *w)
 
 void Toolkit::cb_limbo_page()
 {
-    pvz->UnlockLimboPage(check_limbo_page->value());
+    bool on = check_limbo_page->value();
+    for_each_game([=](PvZ &p)
+                  { p.UnlockLimboPage(on); });
 }
 
 } // namespace Pt
@@ -2,7 +2,9 @@
 #pragma once
 
 #include "pvz.h"
+#include "manager.h"
 #include "pak.h"
+#include "spawnlib.h"
 #include "window.h"
 
 namespace Pt
@@ -36,10 +38,49 @@ class Toolkit : public Window
     static void cb_on_hide_spawn_details(Fl_Widget *, void *);
     inline void cb_on_hide_spawn_details();
 
+    // 当前选中的出怪种类, 和实际刷怪时一样补上必出的种类
+    std::array<bool, 33> selected_spawn_types(int);
+
+    // 按当前设置生成出怪列表, 用于统计, 自然出怪时为空
+    SpawnGenerator spawn_generator();
+
+    // 出怪统计在后台线程里计算, 完成后交给界面线程显示, 同一时间只有一个任务
+    // 正在计算时返回 false, 并询问是否取消
+    bool start_spawn_worker(std::function<void()>);
+    std::thread spawn_worker;
+    std::atomic<bool> spawn_working = false;
+    std::atomic<bool> spawn_cancel = false;
+
+    SPAWN_STATS spawn_stats_result; // 后台线程写入, 界面线程在回调里读取
+    int spawn_stats_view = 0;
+    std::string spawn_stats_title;
+
+    static void cb_spawn_stats_done(void *);
+    inline void cb_spawn_stats_done();
+
+    SpawnGenerator spawn_search_generator; // 搜索用的生成函数, 用来重新生成找到的出怪列表
+    std::vector<SPAWN_SEARCH_RESULT> spawn_search_result;
+
+    static void cb_spawn_search_done(void *);
+    inline void cb_spawn_search_done();
+
+    // 能否把自定义的出怪列表写入游戏, 条件和极限出怪相同, 不能时 reason 为原因
+    bool spawn_list_writable(std::string &reason);
+
   public:
     PvZ *pvz;
     PAK *pak;
 
+    // 多开时同步修改所有游戏窗口
+    ProcessManager *manager;
+    bool sync_all_games = false;
+
+    // 执行修改功能, 开启同步时交给所有游戏实例的工作线程执行 (不等待完成), 否则只改当前连接的游戏
+    void for_each_game(std::function<void(PvZ &)>);
+
+    static void cb_sync_all_games(Fl_Widget *, void *);
+    inline void cb_sync_all_games();
+
     int unpack_result = 0xFFFFFFFF;
     std::string unpack_text;
 
@@ -432,25 +432,81 @@ SpawnTable::~SpawnTable()
 {
 }
 
-void SpawnTable::UpdateData(std::array<int, 1000> zombies_list)
+bool SpawnTable::UpdateData(std::array<int, 1000> zombies_list)
 {
+    // 之前显示的是统计结果或者还没有数据, 从空列表开始算
+    bool full = !last_valid || stats_view >= 0;
+    if (full)
+    {
+        for (size_t r = 0; r < ROWS; r++)
+            for (size_t c = 0; c < COLS; c++)
+                data[r][c] = 0;
+        total = 0;
+        stats_view = -1;
+        last_list.fill(-1);
+    }
+
+    bool shown[ROWS];
     for (size_t r = 0; r < ROWS; r++)
-        for (size_t c = 0; c < COLS; c++)
-            data[r][c] = 0;
-    total = 0;
+        shown[r] = data[r][20 + 1 - 1] != 0;
+    int old_total = total;
 
     for (size_t i = 0; i < 20; i++)
     {
+        const int *old_wave = &last_list[i * 50];
+        const int *new_wave = &zombies_list[i * 50];
+        if (std::equal(old_wave, old_wave + 50, new_wave))
+            continue;
+
+        int diff[ROWS] = {0};
         for (size_t j = 0; j < 50; j++)
         {
-            if (zombies_list[i * 50 + j] >= 33 || zombies_list[i * 50 + j] < 0)
+            if (old_wave[j] >= 0 && old_wave[j] < 33)
+                diff[old_wave[j]] -= 1;
+            if (new_wave[j] >= 0 && new_wave[j] < 33)
+                diff[new_wave[j]] += 1;
+        }
+
+        for (int r = 0; r < ROWS; r++)
+        {
+            if (diff[r] == 0)
                 continue;
-            data[zombies_list[i * 50 + j]][i] += 1;
-            data[zombies_list[i * 50 + j]][20 + 1 - 1] += 1;
-            total += 1;
+            data[r][i] += diff[r];
+            data[r][20 + 1 - 1] += diff[r];
+            total += diff[r];
+            redraw_range(r, r, (int)i, (int)i);
+            redraw_range(r, r, 20 + 1 - 1, 20 + 1 - 1);
         }
     }
 
+    last_list = zombies_list;
+    last_valid = true;
+
+    // 隐藏的行变了之后下面的行都要移动, 总数变了要重画表头, 都整个重画
+    bool layout_changed = full;
+    for (size_t r = 0; r < ROWS; r++)
+        if (shown[r] != (data[r][20 + 1 - 1] != 0))
+            layout_changed = true;
+    if (layout_changed || total != old_total)
+        this->redraw();
+
+    return layout_changed;
+}
+
+void SpawnTable::UpdateData(const SPAWN_STATS &s, int view)
+{
+    stats = s;
+    stats_view = view;
+
+    // data 只用来决定显示哪些行和背景颜色, 取平均数量
+    for (size_t r = 0; r < ROWS; r++)
+        for (size_t c = 0; c < COLS; c++)
+            data[r][c] = (int)(stats.mean[r][c] + 0.5f);
+    for (size_t r = 0; r < ROWS; r++)
+        if (stats.prob[r][20 + 1 - 1] > 0 && data[r][20 + 1 - 1] == 0)
+            data[r][20 + 1 - 1] = 1; // 出现过的种类都显示
+    total = (int)stats.samples;
+
     this->redraw();
 }
 
@@ -459,9 +515,14 @@ void SpawnTable::draw_cell(TableContext context, int ROW = 0, int COL = 0, //
 {
     static char s[100]; // 缓冲
 
+    // 概率按同样的深浅换算成数量
+    int shade = data[ROW][COL];
+    if (stats_view == 1)
+        shade = (int)(stats.prob[ROW][COL] * (COL == (20 + 1 - 1) ? 300 : 20));
+
     // 单波某种僵尸一般不超过 20 只，单轮某种僵尸一般不超过 300 只
-    Fl_Color c_n = 0xffffff00u - 0x01000100u * (min(data[ROW][COL], 20) * 0xffu / 30);   // 背景颜色
-    Fl_Color c_t = 0xffffff00u - 0x01010100u * (min(data[ROW][COL], 300) * 0xffu / 500); // 背景颜色(总数)
+    Fl_Color c_n = 0xffffff00u - 0x01000100u * (min(shade, 20) * 0xffu / 30);   // 背景颜色
+    Fl_Color c_t = 0xffffff00u - 0x01010100u * (min(shade, 300) * 0xffu / 500); // 背景颜色(总数)
     Fl_Color c_f = 0xcccccc00u;                                                          // 旗帜波边框
 
     int Ys = 0; // 因为不画缺少的种类造成的纵向偏移
@@ -480,7 +541,9 @@ void SpawnTable::draw_cell(TableContext context, int ROW = 0, int COL = 0, //
         if (total == 0) // 僵尸列表为空时不画波数表头
             break;
 
-        if (COL == (20 + 1 - 1)) // 最后一列改为显示总数
+        if (COL == (20 + 1 - 1) && stats_view >= 0) // 统计时显示样本数
+            sprintf_s(s, "%s", std::string("n=" + std::to_string(total)).c_str());
+        else if (COL == (20 + 1 - 1)) // 最后一列改为显示总数
             sprintf_s(s, "%s", std::string("(" + std::to_string(total) + ")").c_str());
         else
             sprintf_s(s, "w%i", COL + 1);
@@ -515,7 +578,33 @@ void SpawnTable::draw_cell(TableContext context, int ROW = 0, int COL = 0, //
         if (data[ROW][20 + 1 - 1] == 0) // 不画不出的僵尸种类
             break;
 
-        if (data[ROW][COL] == 0) // 某波某种僵尸数量为 0 干脆不显示
+        if (stats_view == 0) // 平均数量
+        {
+            if (stats.prob[ROW][COL] == 0)
+                sprintf_s(s, "");
+            else
+                sprintf_s(s, "%.1f", stats.mean[ROW][COL]);
+        }
+        else if (stats_view == 1) // 至少出现一只的概率
+        {
+            float p = stats.prob[ROW][COL] * 100;
+            if (p == 0)
+                sprintf_s(s, "");
+            else if (p < 1)
+                sprintf_s(s, "<1%%");
+            else
+                sprintf_s(s, "%.0f%%", p);
+        }
+        else if (stats_view == 2) // 分位数 p10-p90
+        {
+            if (stats.p90[ROW][COL] == 0)
+                sprintf_s(s, "");
+            else if (stats.p10[ROW][COL] == stats.p90[ROW][COL])
+                sprintf_s(s, "%i", stats.p10[ROW][COL]);
+            else
+                sprintf_s(s, "%i-%i", stats.p10[ROW][COL], stats.p90[ROW][COL]);
+        }
+        else if (data[ROW][COL] == 0) // 某波某种僵尸数量为 0 干脆不显示
             sprintf_s(s, "");
         else
             sprintf_s(s, "%i", data[ROW][COL]);
@@ -564,6 +653,10 @@ SpawnWindow::SpawnWindow(int width, int height, const char *title)
     button_zombies_list->add("[刷新]");
     button_zombies_list->add("[保存]");
     button_zombies_list->add("[加载]");
+    button_zombies_list->add("[统计] 平均数量");
+    button_zombies_list->add("[统计] 出现概率");
+    button_zombies_list->add("[统计] 分位数 (p10-p90)");
+    button_zombies_list->add("[搜索]");
     button_zombies_list->type(Fl_Menu_Button::POPUP3);
     button_zombies_list->value(0);
 
@@ -576,6 +669,10 @@ SpawnWindow::SpawnWindow(int width, int height, const char *title)
     button_zombies_list->replace(0, EMOJI("🔄", "[刷新]"));
     button_zombies_list->replace(1, EMOJI("💾", "[保存]"));
     button_zombies_list->replace(2, EMOJI("🔖", "[加载]"));
+    button_zombies_list->replace(3, EMOJI("📊", "[统计] 平均数量"));
+    button_zombies_list->replace(4, EMOJI("📊", "[统计] 出现概率"));
+    button_zombies_list->replace(5, EMOJI("📊", "[统计] 分位数 (p10-p90)"));
+    button_zombies_list->replace(6, EMOJI("🔍", "[搜索]"));
 }
 
 SpawnWindow::~SpawnWindow()
@@ -584,28 +681,30 @@ SpawnWindow::~SpawnWindow()
 
 void SpawnWindow::UpdateData(std::array<int, 1000> zombies_list)
 {
-    table_spawn->UpdateData(zombies_list);
+    // 没有行显示或者隐藏时不用调整窗口
+    if (table_spawn->UpdateData(zombies_list))
+        update_layout();
+}
 
-    int zombies_count[33] = {0};
-    for (size_t i = 0; i < 20; i++)
-    {
-        for (size_t j = 0; j < 50; j++)
-        {
-            if (zombies_list[i * 50 + j] >= 33 || zombies_list[i * 50 + j] < 0)
-                continue;
-            zombies_count[zombies_list[i * 50 + j]] += 1;
-        }
-    }
+void SpawnWindow::UpdateData(const SPAWN_STATS &stats, int view)
+{
+    table_spawn->UpdateData(stats, view);
+    update_layout();
+}
+
+void SpawnWindow::update_layout()
+{
+    // 最后一列为零的种类不显示
     int deleted_rows = 0;
     for (int r = 0; r < 33; r++)
-        if (zombies_count[r] == 0)
+        if (table_spawn->data[r][20 + 1 - 1] == 0)
             deleted_rows += 1;
 
     if (this->on)
     {
         std::string zs;
         for (int r = 0; r < 33; r++)
-            if (zombies_count[r] != 0)
+            if (table_spawn->data[r][20 + 1 - 1] != 0)
                 zs += std::string("[" + std::to_string(r) + "]" + "  " + zombies[r] + "\n");
         box_mask_spawn_types->copy_tooltip(zs.c_str());
     }
@@ -642,6 +741,325 @@ void SpawnWindow::tooltips(bool on)
     this->on = on;
 }
 
+Fl_Lineup_Choice::Fl_Lineup_Choice(int x, int y, int w, int h, const char *l)
+    : Fl_Choice(x, y, w, h, l)
+{
+}
+
+Fl_Lineup_Choice::~Fl_Lineup_Choice()
+{
+}
+
+int Fl_Lineup_Choice::value() const
+{
+    return index;
+}
+
+void Fl_Lineup_Choice::value(int v)
+{
+    int count = size();
+    index = (count == 0) ? -1 : std::clamp(v, 0, count - 1);
+
+    // 菜单里只有一项, 用来显示当前的名称
+    Fl_Choice::clear();
+    if (index != -1)
+    {
+        Fl_Choice::add("-");
+        Fl_Choice::replace(0, (*names)[(*order)[index]].c_str());
+        Fl_Choice::value(0);
+    }
+    redraw();
+}
+
+int Fl_Lineup_Choice::size() const
+{
+    return order == nullptr ? 0 : (int)order->size();
+}
+
+int Fl_Lineup_Choice::handle(int event)
+{
+    switch (event)
+    {
+    case FL_ENTER:
+        scrollable = true;
+        return 1;
+    case FL_LEAVE:
+        scrollable = false;
+        return 1;
+    case FL_MOUSEWHEEL:
+        if (scrollable && size() > 0)
+        {
+            if (Fl::event_dy() == -1) // 向上滚
+                value(index - 1);
+            else // 向下滚
+                value(index + 1);
+            do_callback();
+        }
+        return 1;
+    case FL_PUSH:
+        if (picker != nullptr && size() > 0)
+            picker->Open(this);
+        return 1;
+    case FL_KEYBOARD:
+        if (Fl::event_key() == ' ' && picker != nullptr && size() > 0)
+        {
+            picker->Open(this);
+            return 1;
+        }
+        return Fl_Choice::handle(event);
+    default:
+        return Fl_Choice::handle(event);
+    }
+}
+
+LineupTable::LineupTable(int X, int Y, int W, int H, const char *L = 0)
+    : Fl_Table_Row(X, Y, W, H, L)
+{
+    rows(0);
+    row_header(0);
+    row_height_all(20);
+    row_resize(0);
+
+    cols(1);
+    col_header(0);
+    col_width(0, W - Fl::scrollbar_size() - 4);
+    col_resize(0);
+
+    type(SELECT_SINGLE);
+    visible_focus(0); // 焦点留在输入框
+
+    end();
+}
+
+LineupTable::~LineupTable()
+{
+}
+
+void LineupTable::UpdateData()
+{
+    // 行数就是筛选后的阵型个数, 只有看得见的行才会画
+    rows((int)ids.size());
+    this->redraw();
+}
+
+void LineupTable::draw_cell(TableContext context, int ROW = 0, int COL = 0, //
+                            int X = 0, int Y = 0, int W = 0, int H = 0)
+{
+    switch (context)
+    {
+    case CONTEXT_STARTPAGE:
+        extern Fl_Font ui_font;
+        fl_font(ui_font, 14);
+        return;
+
+    case CONTEXT_CELL:
+        if (names == nullptr || ROW < 0 || (size_t)ROW >= ids.size())
+            return;
+
+        fl_push_clip(X, Y, W, H);
+        {
+            bool selected = row_selected(ROW) == 1;
+            // 背景
+            fl_color(selected ? selection_color() : FL_BACKGROUND2_COLOR);
+            fl_rectf(X, Y, W, H);
+            // 名称, 不解析 @ 符号
+            fl_color(selected ? fl_contrast(FL_FOREGROUND_COLOR, selection_color()) : FL_FOREGROUND_COLOR);
+            fl_draw((*names)[ids[ROW]].c_str(), X + 4, Y, W - 4, H, FL_ALIGN_LEFT, nullptr, 0);
+        }
+        fl_pop_clip();
+
+        return;
+
+    default:
+        return;
+    }
+}
+
+// 不区分 ASCII 大小写的子串查找
+static bool contains_ignore_case(std::string_view text, std::string_view key)
+{
+    auto equal = [](char a, char b)
+    {
+        if (a >= 'A' && a <= 'Z')
+            a = (char)(a - 'A' + 'a');
+        if (b >= 'A' && b <= 'Z')
+            b = (char)(b - 'A' + 'a');
+        return a == b;
+    };
+    return std::search(text.begin(), text.end(), key.begin(), key.end(), equal) != text.end();
+}
+
+LineupPickerWindow::LineupPickerWindow(int width, int height, const char *title)
+    : Fl_Double_Window(width, height, title)
+{
+    // 参数 width height title 均被忽略
+
+    // 设置窗口标题
+    this->copy_label("选择阵型");
+
+    // 设置窗口大小
+    int w = 5 + 300 + 5;
+    int h = 5 + 25 + 5 + 400 + 5;
+    this->size(w, h);
+
+    input_filter = new Fl_Input(5, 5, 300, 25, "");
+    table_lineup = new LineupTable(5, 5 + 25 + 5, 300, 400);
+    this->end();
+
+    this->set_modal();
+
+    extern Fl_Font ui_font;
+
+    input_filter->textfont(ui_font);
+    input_filter->callback(cb_filter, this);
+    input_filter->when(FL_WHEN_CHANGED);
+    table_lineup->callback(cb_table, this);
+}
+
+LineupPickerWindow::~LineupPickerWindow()
+{
+}
+
+int LineupPickerWindow::handle(int event)
+{
+    // 焦点在输入框里, 输入框不用的按键在这里处理
+    if (event == FL_KEYBOARD && target != nullptr)
+    {
+        int r1, r2, c1, c2;
+        table_lineup->visible_cells(r1, r2, c1, c2);
+        int page = std::max(r2 - r1, 1);
+
+        switch (Fl::event_key())
+        {
+        case FL_Up:
+            select(current - 1);
+            return 1;
+        case FL_Down:
+            select(current + 1);
+            return 1;
+        case FL_Page_Up:
+            select(current - page);
+            return 1;
+        case FL_Page_Down:
+            select(current + page);
+            return 1;
+        case FL_Enter:
+        case FL_KP_Enter:
+            choose(true);
+            return 1;
+        default:
+            break;
+        }
+    }
+    return Fl_Double_Window::handle(event);
+}
+
+void LineupPickerWindow::Open(Fl_Lineup_Choice *choice)
+{
+    this->target = choice;
+    table_lineup->names = choice->names;
+    input_filter->value("");
+    current = -1;
+    Refresh();
+
+    // 显示在下拉框下面
+    Fl_Window *parent = choice->window();
+    if (parent != nullptr)
+        this->position(parent->x() + choice->x(), parent->y() + choice->y() + choice->h());
+
+    this->show();
+    input_filter->take_focus();
+}
+
+void LineupPickerWindow::Refresh()
+{
+    if (target == nullptr)
+        return;
+
+    // 之前选中的阵型, 没有的话是下拉框当前的
+    size_t selected = LINEUP_NOT_FOUND;
+    if (current >= 0 && (size_t)current < table_lineup->ids.size())
+        selected = table_lineup->ids[current];
+    else if (target->value() >= 0)
+        selected = (*target->order)[target->value()];
+
+    std::string key = input_filter->value();
+    auto &ids = table_lineup->ids;
+    ids.clear();
+    for (size_t id : *target->order)
+        if (key.empty() || contains_ignore_case((*target->names)[id], key))
+            ids.push_back(id);
+    table_lineup->UpdateData();
+
+    auto it = std::find(ids.begin(), ids.end(), selected);
+    current = -1;
+    select(it != ids.end() ? int(it - ids.begin()) : 0);
+}
+
+void LineupPickerWindow::select(int row)
+{
+    int count = (int)table_lineup->ids.size();
+    table_lineup->select_all_rows(0);
+    if (count == 0)
+    {
+        current = -1;
+        return;
+    }
+
+    current = std::clamp(row, 0, count - 1);
+    table_lineup->select_row(current, 1);
+
+    // 滚动到能看见
+    int r1, r2, c1, c2;
+    table_lineup->visible_cells(r1, r2, c1, c2);
+    if (current < r1)
+        table_lineup->row_position(current);
+    else if (current >= r2)
+        table_lineup->row_position(std::max(current - (r2 - r1) + 1, 0));
+}
+
+void LineupPickerWindow::choose(bool close)
+{
+    if (target != nullptr && current >= 0 && (size_t)current < table_lineup->ids.size())
+    {
+        size_t id = table_lineup->ids[current];
+        auto it = std::find(target->order->begin(), target->order->end(), id);
+        if (it != target->order->end())
+        {
+            target->value(int(it - target->order->begin()));
+            target->do_callback();
+        }
+    }
+
+    if (close)
+        this->hide();
+}
+
+void LineupPickerWindow::cb_filter(Fl_Widget *, void *w)
+{
+    ((LineupPickerWindow *)w)->cb_filter();
+}
+
+void LineupPickerWindow::cb_filter()
+{
+    current = -1;
+    Refresh();
+}
+
+void LineupPickerWindow::cb_table(Fl_Widget *, void *w)
+{
+    ((LineupPickerWindow *)w)->cb_table();
+}
+
+void LineupPickerWindow::cb_table()
+{
+    // 单击选中, 双击选中并关闭
+    if (Fl::event() != FL_PUSH || table_lineup->callback_context() != Fl_Table::CONTEXT_CELL)
+        return;
+    select(table_lineup->callback_row());
+    choose(Fl::event_clicks() > 0);
+}
+
 Window::Window(int width, int height, const char *title)
     : Fl_Double_Window(width, height, title)
 {
@@ -756,14 +1174,15 @@ Window::Window(int width, int height, const char *title)
                 button_reset = new Fl_Button(c(1), r(3), iw + 12, ih, "重置场地");
                 choice_scene = new Fl_Choice_(c(2) + 12, r(3), iw - 12, ih, "");
                 button_load_lineup = new Fl_Button(c(3), r(3), iw * 2 + 10, ih, "加载阵型列表文件 (***.yml)");
-                choice_lineup_name[0] = new Fl_Choice_(c(3), r(3), iw * 2 + 10, ih, "");
-                choice_lineup_name[1] = new Fl_Choice_(c(3), r(3), iw * 2 + 10, ih, "");
-                choice_lineup_name[2] = new Fl_Choice_(c(3), r(3), iw * 2 + 10, ih, "");
-                choice_lineup_name[3] = new Fl_Choice_(c(3), r(3), iw * 2 + 10, ih, "");
-                choice_lineup_name[4] = new Fl_Choice_(c(3), r(3), iw * 2 + 10, ih, "");
-                choice_lineup_name[5] = new Fl_Choice_(c(3), r(3), iw * 2 + 10, ih, "");
+                choice_lineup_name[0] = new Fl_Lineup_Choice(c(3), r(3), iw * 2 + 10, ih, "");
+                choice_lineup_name[1] = new Fl_Lineup_Choice(c(3), r(3), iw * 2 + 10, ih, "");
+                choice_lineup_name[2] = new Fl_Lineup_Choice(c(3), r(3), iw * 2 + 10, ih, "");
+                choice_lineup_name[3] = new Fl_Lineup_Choice(c(3), r(3), iw * 2 + 10, ih, "");
+                choice_lineup_name[4] = new Fl_Lineup_Choice(c(3), r(3), iw * 2 + 10, ih, "");
+                choice_lineup_name[5] = new Fl_Lineup_Choice(c(3), r(3), iw * 2 + 10, ih, "");
+                input_lineup_filter = new Fl_Input(c(1), r(4), iw * 4 + 10 * 3, ih, "");
                 buffer_lineup_string = new Fl_Text_Buffer();
-                editor_lineup_string = new Fl_Text_Editor(c(1), r(4), iw * 4 + 10 * 3, ih * 2 + 10 + 2, "");
+                editor_lineup_string = new Fl_Text_Editor(c(1), r(4) + ih + 5, iw * 4 + 10 * 3, ih + 10, "");
                 button_get_lineup = new Fl_Button(c(1), r(6), iw - 15, ih, "获取代码");
                 button_copy_lineup = new Fl_Button(c(2) - 15, r(6), iw - 15, ih, "复制导出");
                 button_paste_lineup = new Fl_Button(c(3) + 15 + 15, r(6), iw - 15, ih, "粘贴导入");
@@ -816,6 +1235,7 @@ Window::Window(int width, int height, const char *title)
                 check_tooltips = new Fl_Check_Button(c(2) - 15, r(6), iw + 35, ih, "English Tooltips");
                 button_document = new Fl_Button(c(3) + 30, r(6), iw - 15, ih, "文档");
                 button_about = new Fl_Button(c(4) + 15, r(6), iw - 15, ih, "关于 ...");
+                button_others_extra = new Fl_Menu_Button(m, m + th, w - m * 2, h - m * 2 - th - 42, nullptr);
             }
             group_others->end();
         }
@@ -971,12 +1391,29 @@ Window::Window(int width, int height, const char *title)
     choice_scene->value(2); // 泳池
 
     lineups.clear();
-    lineup_count[0] = 0;
-    lineup_count[1] = 0;
-    lineup_count[2] = 0;
-    lineup_count[3] = 0;
-    lineup_count[4] = 0;
-    lineup_count[5] = 0;
+    lineup_index.Clear();
+    lineup_search.Clear();
+    lineup_order[0].clear();
+    lineup_order[1].clear();
+    lineup_order[2].clear();
+    lineup_order[3].clear();
+    lineup_order[4].clear();
+    lineup_order[5].clear();
+    for (size_t i = 0; i < 6; i++)
+        lineup_sorted[i].clear();
+    lineup_filter.Clear();
+    lineup_names.clear();
+
+    // 阵型列表很长的时候下拉菜单没法用, 改成弹出可以筛选的列表
+    window_lineup_picker = new LineupPickerWindow(0, 0, "");
+    for (size_t i = 0; i < 6; i++)
+    {
+        lineup_names_used[i].clear();
+        lineup_names_spaces[i].clear();
+        choice_lineup_name[i]->order = &lineup_order[i];
+        choice_lineup_name[i]->names = &lineup_names;
+        choice_lineup_name[i]->picker = window_lineup_picker;
+    }
 
     choice_lineup_name[0]->hide();
     choice_lineup_name[1]->hide();
@@ -1053,6 +1490,10 @@ Window::Window(int width, int height, const char *title)
 
     choice_scheme->value(0); // base
 
+    button_others_extra->add("[同步修改所有游戏]");
+    button_others_extra->type(Fl_Menu_Button::POPUP3);
+    button_others_extra->value(0);
+
     // 默认打开后台运行和显示隐藏游戏
     check_background->value(1);
     check_limbo_page->value(1);
@@ -1082,6 +1523,8 @@ Window::Window(int width, int height, const char *title)
     choice_lineup_name[3]->callback(cb_show_lineup_string, this);
     choice_lineup_name[4]->callback(cb_show_lineup_string, this);
     choice_lineup_name[5]->callback(cb_show_lineup_string, this);
+    input_lineup_filter->callback(cb_filter_lineup, this);
+    input_lineup_filter->when(FL_WHEN_CHANGED);
     button_copy_lineup->callback(cb_copy_lineup, this);
     button_paste_lineup->callback(cb_paste_lineup, this);
 
@@ -1154,6 +1597,7 @@ Window::Window(int width, int height, const char *title)
             choice_lineup_name[3]->textfont(ui_font);
             choice_lineup_name[4]->textfont(ui_font);
             choice_lineup_name[5]->textfont(ui_font);
+            input_lineup_filter->textfont(ui_font);
             editor_lineup_string->textfont(ls_font); // 阵型字符串特殊字体
             editor_lineup_string->textsize(16);
         }
@@ -1173,6 +1617,7 @@ Window::Window(int width, int height, const char *title)
             choice_debug->textfont(ui_font);
             choice_speed->textfont(ui_font);
             choice_scheme->textfont(ui_font);
+            button_others_extra->textfont(ui_font);
         }
     }
 
@@ -1199,6 +1644,8 @@ Window::Window(int width, int height, const char *title)
     button_spawn_extra->replace(0, EMOJI("❌", "[清空已选]"));
     button_spawn_extra->replace(1, EMOJI("❎", "[取消限制]"));
 
+    button_others_extra->replace(0, EMOJI("✅", "[同步修改所有游戏]"));
+
     button_show_details->copy_label(EMOJI("📈", "查看详情"));
 
     button_music->copy_label(EMOJI("🎵", "背景音乐"));
@@ -1229,6 +1676,11 @@ Window::Window(int width, int height, const char *title)
 
 Window::~Window()
 {
+    // 停止还没有完成的阵型列表导入
+    lineup_loader_stop = true;
+    if (lineup_loader.joinable())
+        lineup_loader.join();
+
     WriteSettings(); // 保存设置
 }
 
@@ -1777,6 +2229,19 @@ void Window::cb_load_lineup()
 
 void Window::import_lineup_list(bool automatic)
 {
+    // 同一时间只有一个后台导入线程
+    if (this->lineup_loading)
+    {
+        if (!automatic)
+        {
+            fl_message_title("加载阵型列表");
+            fl_message("正在后台导入阵型列表, 请等待导入完成后再加载其他文件.");
+        }
+        return;
+    }
+
+    std::vector<std::wstring> files;
+
     if (automatic)
     {
         wchar_t find_path[MAX_PATH] = {0};
@@ -1794,10 +2259,7 @@ void Window::import_lineup_list(bool automatic)
                     continue;
                 std::wstring ext = name.substr(name.find_last_of(L".") + 1);
                 if (ext == L"yml")
-                {
-                    import_lineup_list_file(name.c_str());
-                    // std::wcout << L"导入阵型列表: " << name << std::endl;
-                }
+                    files.push_back(std::filesystem::absolute(name).wstring()); // 打开文件对话框会改变当前目录
             } while (FindNextFileW(hf, &ffd) != 0);
             FindClose(hf);
         }
@@ -1823,75 +2285,132 @@ void Window::import_lineup_list(bool automatic)
 #ifdef _DEBUG
             std::wcout << L"打开文件: " << std::wstring(szFileName) << std::endl;
 #endif
-            import_lineup_list_file(szFileName);
+            files.push_back(szFileName);
         }
     }
 
-    if (this->lineups.empty())
+    if (files.empty())
         return;
 
-    // 排序
-    auto LessThan = [&](const Lineup &l1, const Lineup &l2)
-    { return l1.weight < l2.weight; };
-    std::sort(this->lineups.begin(), this->lineups.end(), LessThan);
+    // 在后台线程读取和解码, 每读完一批就交给界面线程插入
+    if (this->lineup_loader.joinable())
+        this->lineup_loader.join();
+    this->lineup_loading = true;
+    this->lineup_loader = std::thread(&Window::lineup_loader_thread, this, files);
+}
 
-    // 插入
-    for (size_t i = 0; i < this->lineups.size(); i++)
+void Window::post_lineup_batch(LINEUP_BATCH &&batch)
+{
     {
-        uint32_t scene = static_cast<uint32_t>(this->lineups[i].scene);
-        std::string name = this->lineups[i].lineup_name;
-
-        while (choice_lineup_name[scene]->find_index(name.c_str()) != -1)
-            name += " "; // 相同名字的在后面补空格
-
-        choice_lineup_name[scene]->add(name.c_str());
-        lineup_count[scene]++;
+        std::lock_guard<std::mutex> lock(this->lineup_batch_mutex);
+        this->lineup_batches.push_back(std::move(batch));
     }
-
-    for (size_t i = 0; i < 6; i++)
-        if (choice_lineup_name[i]->size() > 0)
-            choice_lineup_name[i]->value(0);
-
-    button_load_lineup->hide();
-    cb_switch_lineup_scene();
+    Fl::awake(cb_lineup_batch, this);
 }
 
-void Window::import_lineup_list_file(std::wstring file)
+void Window::lineup_loader_thread(std::vector<std::wstring> files)
 {
-    std::ifstream ifs(file.c_str());
-    if (!ifs)
-        return;
+    const size_t batch_size = 512;
 
-    std::vector<std::tuple<int, std::string>> err_lst;
-
-    int line = 0;
-    std::string str;
-    while (std::getline(ifs, str))
+    for (const auto &file : files)
     {
-        line++;
-        if (line == 1) // 第一行
+        if (this->lineup_loader_stop)
+            break;
+
+        std::vector<Lineup> file_lineups; // 按文件中的顺序, 还没有去重, 用于写缓存
+        LINEUP_BATCH batch;
+        batch.file = file;
+        batch.file_done = false;
+
+        // 文件没有变化时直接用缓存, 不用再解析和解码
+        LineupCache cache;
+        if (cache.Load(file))
         {
-            if (str != "#! pvztoolkit")
-                break;
+            for (size_t i = 0; i < cache.Count() && !this->lineup_loader_stop; i++)
+            {
+                LINEUP_DECODE_RESULT result = {cache.Data(i), LINEUP_DECODE_OK};
+                batch.lineups.emplace_back(std::string(cache.Name(i)), std::string(cache.Code(i)), result);
+                if (batch.lineups.size() == batch_size)
+                {
+                    post_lineup_batch(std::move(batch));
+                    batch = LINEUP_BATCH{file, {}, {}, false};
+                }
+            }
+            for (size_t i = 0; i < cache.ErrorCount(); i++)
+            {
+                auto [l, s] = cache.Error(i);
+                batch.errors.push_back({l, std::string(s)});
+            }
+            batch.file_done = true;
+            post_lineup_batch(std::move(batch));
+            continue;
         }
-        else
+
+        std::ifstream ifs(file.c_str());
+        if (!ifs)
+            continue;
+
+        std::vector<std::tuple<int, std::string>> err_lst;
+        std::vector<std::tuple<int, std::string, std::string, std::string>> items; // 行号 原文 名称 代码
+
+        // 批量解码一批, 结果交给界面线程
+        auto flush = [&]()
         {
-            if (str[0] == '#' || str.empty()) // 注释或者空行
+            std::vector<std::string_view> codes;
+            codes.reserve(items.size());
+            for (auto &[l, s, name, code] : items)
+                codes.push_back(code);
+            std::vector<LINEUP_DECODE_RESULT> results = Lineup::DecodeMany(codes);
+
+            for (size_t i = 0; i < items.size(); i++)
             {
-                continue;
+                auto &[l, s, name, code] = items[i];
+                // 解码失败的按原来的方式再试一次 (可能是阵型字符串)
+                Lineup lineup = (results[i].error == LINEUP_DECODE_OK) ? Lineup(name, code, results[i]) : Lineup(name, code);
+                if (lineup.OK())
+                {
+                    file_lineups.push_back(lineup);
+                    batch.lineups.push_back(lineup);
+                }
+                else
+                {
+                    std::tuple err = {l, s};
+                    err_lst.push_back(err);
+                }
+            }
+            items.clear();
+
+            if (!batch.lineups.empty())
+            {
+                post_lineup_batch(std::move(batch));
+                batch = LINEUP_BATCH{file, {}, {}, false};
+            }
+        };
+
+        int line = 0;
+        std::string str;
+        while (std::getline(ifs, str) && !this->lineup_loader_stop)
+        {
+            line++;
+            if (line == 1) // 第一行
+            {
+                if (str != "#! pvztoolkit")
+                    break;
             }
             else
             {
-                std::regex re("\".*\": [a-zA-Z0-9+/=]{1,}");
-                if (std::regex_match(str, re))
+                if (str[0] == '#' || str.empty()) // 注释或者空行
+                {
+                    continue;
+                }
+                else
                 {
-                    size_t p = str.find_last_of(": ");
-                    std::string name = str.substr(0 + 1, p - 3);
-                    std::string code = str.substr(p + 1);
-                    Lineup lineup(name, code);
-                    if (lineup.OK())
+                    std::string name, code;
+                    if (Lineup::ParseListLine(str, name, code))
                     {
-                        this->lineups.push_back(lineup);
+                        items.push_back({line, str, name, code});
+                        if (items.size() == batch_size)
+                            flush();
                     }
                     else
                     {
@@ -1899,36 +2418,196 @@ void Window::import_lineup_list_file(std::wstring file)
                         err_lst.push_back(err);
                     }
                 }
-                else
-                {
-                    std::tuple err = {line, str};
-                    err_lst.push_back(err);
-                }
             }
         }
+        if (this->lineup_loader_stop)
+            break;
+        flush();
+
+        // 按行号排序, 和原来的提示顺序一致
+        std::sort(err_lst.begin(), err_lst.end());
+        LineupCache::Save(file, file_lineups, err_lst);
+
+        batch.errors = std::move(err_lst);
+        batch.file_done = true;
+        post_lineup_batch(std::move(batch));
     }
 
-    if (err_lst.size() > 0)
+    this->lineup_loading = false;
+}
+
+void Window::cb_lineup_batch(void *w)
+{
+    ((Window *)w)->cb_lineup_batch();
+}
+
+void Window::cb_lineup_batch()
+{
+    std::deque<LINEUP_BATCH> batches;
     {
-        std::wstring title = file + L" " + L"阵型列表文件格式错误";
-        std::wstring text;
-        for (size_t i = 0; i < err_lst.size(); i++)
+        std::lock_guard<std::mutex> lock(this->lineup_batch_mutex);
+        batches.swap(this->lineup_batches);
+    }
+    if (batches.empty())
+        return;
+
+    bool was_empty = this->lineups.empty();
+    int current_scene = choice_scene->value();
+    bool current_was_empty = (current_scene >= 0 && current_scene < 6) ? lineup_order[current_scene].empty() : false;
+
+    // 记下每个场地当前选中的阵型, 插入后恢复
+    size_t selected[6];
+    for (size_t i = 0; i < 6; i++)
+    {
+        int v = choice_lineup_name[i]->value();
+        selected[i] = (v >= 0 && (size_t)v < lineup_order[i].size()) ? lineup_order[i][v] : LINEUP_NOT_FOUND;
+    }
+
+    std::vector<LINEUP_BATCH> finished;
+    for (auto &batch : batches)
+    {
+        size_t duplicate_count = 0;
+        for (auto &lineup : batch.lineups)
         {
-            if (i > 11)
+            // 相同的阵型只保留第一个 (包括之前导入的文件)
+            size_t id = this->lineups.size();
+            if (this->lineup_index.Insert(lineup, id) != id)
             {
-                text += std::wstring() + L"\n" + L"（还有更多的没有显示……）";
-                break;
+                duplicate_count++;
+                continue;
             }
-            auto [l, s] = err_lst[i];
-            if (s.length() > 49)
-                s = s.substr(0, 48) + " ...";
-            text += std::wstring()                            //
-                    + L"第 " + std::to_wstring(l) + L" 行： " //
-                    + utf8_decode(s) + L"\n";                 //
+            this->lineup_search.Add(lineup, id);
+            this->lineup_filter.Add(lineup);
+            this->lineups.push_back(std::move(lineup));
+            insert_lineup_choice(id);
+        }
+
+#ifdef _DEBUG
+        std::wcout << L"导入阵型列表: " << batch.file << L" " << batch.lineups.size() //
+                   << L" 重复 " << duplicate_count << std::endl;
+#endif
+
+        if (batch.file_done && !batch.errors.empty())
+            finished.push_back(std::move(batch));
+    }
+
+    for (size_t i = 0; i < 6; i++)
+    {
+        auto it = std::find(lineup_order[i].begin(), lineup_order[i].end(), selected[i]);
+        choice_lineup_name[i]->value(it != lineup_order[i].end() ? int(it - lineup_order[i].begin()) : 0);
+    }
+
+    if (window_lineup_picker->shown())
+        window_lineup_picker->Refresh();
+
+    if (was_empty && !this->lineups.empty())
+    {
+        button_load_lineup->hide();
+        cb_switch_lineup_scene();
+    }
+    else if (current_was_empty && !lineup_order[current_scene].empty())
+    {
+        cb_show_lineup_string();
+    }
+
+    // 最后再弹窗, 弹窗期间到达的批次会在嵌套的消息循环里处理
+    for (auto &batch : finished)
+        show_lineup_errors(batch.file, batch.errors);
+}
+
+std::string Window::unique_lineup_name(uint32_t scene, const std::string &name)
+{
+    // 相同名字的在后面补空格, 记下这个名字已经补到了几个, 不用每次从头试
+    size_t &spaces = lineup_names_spaces[scene][name];
+    std::string unique = name + std::string(spaces, ' ');
+    while (!lineup_names_used[scene].insert(unique).second)
+        unique += " ";
+    spaces = unique.size() - name.size() + 1;
+    return unique;
+}
+
+void Window::insert_lineup_choice(size_t id)
+{
+    const Lineup &lineup = this->lineups[id];
+    uint32_t scene = static_cast<uint32_t>(lineup.scene);
+
+    assert(lineup_names.size() == id);
+    lineup_names.push_back(scene < 6 ? unique_lineup_name(scene, lineup.lineup_name) : lineup.lineup_name);
+    if (scene >= 6)
+        return;
+
+    // 按权重插入到相同权重的最后面
+    auto LessThan = [&](long long weight, size_t i)
+    { return weight < this->lineups[i].weight; };
+    auto &sorted = lineup_sorted[scene];
+    sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), lineup.weight, LessThan), id);
+
+    // 不满足筛选条件的不显示
+    if (!lineup_filter.Test(lineup_query, id))
+        return;
+
+    auto &order = lineup_order[scene];
+    order.insert(std::upper_bound(order.begin(), order.end(), lineup.weight, LessThan), id);
+}
+
+void Window::cb_filter_lineup(Fl_Widget *, void *w)
+{
+    ((Window *)w)->cb_filter_lineup();
+}
+
+void Window::cb_filter_lineup()
+{
+    LineupQuery query;
+    if (!query.Parse(input_lineup_filter->value(), {plants, plants_zh}))
+    {
+        input_lineup_filter->textcolor(FL_RED); // 条件写错了, 保留原来的结果
+        input_lineup_filter->redraw();
+        return;
+    }
+    input_lineup_filter->textcolor(FL_FOREGROUND_COLOR);
+    input_lineup_filter->redraw();
+
+    this->lineup_query = std::move(query);
+    std::vector<uint64_t> bitmap = lineup_filter.Evaluate(lineup_query);
+
+    for (size_t i = 0; i < 6; i++)
+    {
+        // 还在结果里的话保持选中
+        int v = choice_lineup_name[i]->value();
+        size_t selected = (v >= 0 && (size_t)v < lineup_order[i].size()) ? lineup_order[i][v] : LINEUP_NOT_FOUND;
+
+        lineup_order[i].clear();
+        for (size_t id : lineup_sorted[i])
+            if (bitmap[id / 64] & (1ull << (id % 64)))
+                lineup_order[i].push_back(id);
+
+        auto it = std::find(lineup_order[i].begin(), lineup_order[i].end(), selected);
+        choice_lineup_name[i]->value(it != lineup_order[i].end() ? int(it - lineup_order[i].begin()) : 0);
+    }
+
+    cb_show_lineup_string();
+}
+
+void Window::show_lineup_errors(const std::wstring &file, const std::vector<std::tuple<int, std::string>> &err_lst)
+{
+    std::wstring title = file + L" " + L"阵型列表文件格式错误";
+    std::wstring text;
+    for (size_t i = 0; i < err_lst.size(); i++)
+    {
+        if (i > 11)
+        {
+            text += std::wstring() + L"\n" + L"（还有更多的没有显示……）";
+            break;
         }
-        fl_message_title(utf8_encode(title).c_str());
-        fl_message(utf8_encode(text).c_str());
+        auto [l, s] = err_lst[i];
+        if (s.length() > 49)
+            s = s.substr(0, 48) + " ...";
+        text += std::wstring()                            //
+                + L"第 " + std::to_wstring(l) + L" 行： " //
+                + utf8_decode(s) + L"\n";                 //
     }
+    fl_message_title(utf8_encode(title).c_str());
+    fl_message(utf8_encode(text).c_str());
 }
 
 void Window::cb_switch_lineup_scene(Fl_Widget *, void *w)
@@ -1960,16 +2639,15 @@ void Window::cb_show_lineup_string(Fl_Widget *, void *w)
 
 void Window::cb_show_lineup_string()
 {
-    if (lineup_count[choice_scene->value()] == 0)
+    int scene = choice_scene->value();
+    int value = choice_lineup_name[scene]->value();
+    if (value < 0 || (size_t)value >= lineup_order[scene].size())
     {
         buffer_lineup_string->text("");
         return;
     }
 
-    int index = 0;
-    for (int i = 0; i < choice_scene->value(); i++)
-        index += lineup_count[i];
-    index += choice_lineup_name[choice_scene->value()]->value();
+    size_t index = lineup_order[scene][value];
 
 #ifdef _DEBUG
     std::cout << index << " " << this->lineups[index].lineup_name << std::endl;
@@ -2436,6 +3114,8 @@ void Window::cb_tooltips()
     button_paste_lineup->copy_tooltip(on ? "Paste / Import" : nullptr);
     button_set_lineup->copy_tooltip(on ? "Apply Current Build" : nullptr);
     editor_lineup_string->copy_tooltip(on ? "(Lineup Code)" : "(阵型代码)");
+    input_lineup_filter->copy_tooltip(on ? "(Filter) e.g. pool cob>=8 !gloom ladder | roof"
+                                         : "(筛选条件) 例如 泳池 玉米加农炮>=8 !忧郁蘑菇 梯子 | 屋顶");
     button_capture->copy_tooltip(on ? "Screenshot To Clipboard" : "截图到剪贴板");
 
     for (size_t i = 0; i < 20; i++)
@@ -15,6 +15,7 @@
 #include <FL/Fl_Text_Editor.H>
 #include <FL/Fl_Choice.H>
 #include <FL/Fl_Table.H>
+#include <FL/Fl_Table_Row.H>
 #include <FL/fl_ask.H>
 
 #include <Windows.h>
@@ -30,14 +31,33 @@
 #include <filesystem>
 #include <regex>
 #include <algorithm>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <charconv>
 
 #include "pvz.h"
 #include "lineup.h"
+#include "library.h"
+#include "cache.h"
+#include "spawn.h"
 #include "../res/version.h"
 
 namespace Pt
 {
 
+// 后台导入阵型列表时每次交给界面线程的一批阵型
+struct LINEUP_BATCH
+{
+    std::wstring file;                                // 阵型列表文件
+    std::vector<Lineup> lineups;                      // 解码成功的阵型, 还没有去重
+    std::vector<std::tuple<int, std::string>> errors; // 格式错误的行, 文件读完时才有
+    bool file_done;                                   // 是否是这个文件的最后一批
+};
+
 #define EMOJI(e, s) ((std::string(this->emoji ? (e) : "▢") + ((s)[0] == 0 ? "" : " ") + (s)).c_str())
 
 // 实现 Fl_Choice 对滚轮的响应
@@ -67,13 +87,23 @@ class SpawnTable : public Fl_Table
   public:
     SpawnTable(int, int, int, int, const char *);
     ~SpawnTable();
-    void UpdateData(std::array<int, 1000>);
+
+    // 和上次的出怪列表逐波比较, 只更新变化的数量和格子, 返回显示的行是否变化
+    bool UpdateData(std::array<int, 1000>);
+    void UpdateData(const SPAWN_STATS &, int);
 
   public:
     static const int ROWS = 33;     // 33 种僵尸
     static const int COLS = 20 + 1; // 20 波 + 总数
     int data[ROWS][COLS] = {{0}};
     int total = 0;
+    // 显示多次生成的统计结果, -1 为单个出怪列表, 0 平均数量, 1 出现概率, 2 分位数 p10-p90
+    int stats_view = -1;
+    SPAWN_STATS stats;
+
+  private:
+    std::array<int, 1000> last_list; // 上次的出怪列表, data 为它的统计
+    bool last_valid = false;
     void draw_cell(TableContext, int, int, int, int, int, int);
 };
 
@@ -83,6 +113,8 @@ class SpawnWindow : public Fl_Double_Window
     SpawnWindow(int, int, const char *);
     ~SpawnWindow();
     void UpdateData(std::array<int, 1000>);
+    void UpdateData(const SPAWN_STATS &, int);
+    void update_layout();
 
   public:
     SpawnTable *table_spawn;
@@ -90,12 +122,81 @@ class SpawnWindow : public Fl_Double_Window
     Fl_Menu_Button *button_zombies_list;
     Fl_Box *box_mask_spawn_types;
     bool emoji = false;
+    std::string spawn_constraints;         // 上次搜索用的约束条件
+    std::string spawn_search = "100000 5"; // 上次搜索的种子数量和列出的结果数量
 
   public:
     void tooltips(bool);
     bool on = false;
 };
 
+class LineupPickerWindow;
+
+// 阵型名称下拉框, 菜单里只放当前选中的一项用来显示, 点击时弹出可以筛选的阵型列表
+// value() 是在 order 里的位置, 没有阵型时为 -1
+class Fl_Lineup_Choice : public Fl_Choice
+{
+  public:
+    Fl_Lineup_Choice(int, int, int, int, const char *);
+    ~Fl_Lineup_Choice();
+    int handle(int);
+
+    int value() const;
+    void value(int); // order 变了之后也要调用一次, 刷新显示的名称
+    int size() const;
+
+  public:
+    const std::vector<size_t> *order = nullptr;      // 显示的阵型序号
+    const std::vector<std::string> *names = nullptr; // 阵型序号 -> 名称
+    LineupPickerWindow *picker = nullptr;
+    bool scrollable = false;
+
+  private:
+    int index = -1;
+};
+
+// 阵型名称列表, 只画看得见的行
+class LineupTable : public Fl_Table_Row
+{
+  public:
+    LineupTable(int, int, int, int, const char *);
+    ~LineupTable();
+    void UpdateData();
+
+  public:
+    std::vector<size_t> ids;                         // 每一行的阵型序号
+    const std::vector<std::string> *names = nullptr; // 阵型序号 -> 名称
+    void draw_cell(TableContext, int, int, int, int, int, int);
+};
+
+// 选择阵型的窗口, 上面输入名字筛选, 下面是阵型列表
+class LineupPickerWindow : public Fl_Double_Window
+{
+  public:
+    LineupPickerWindow(int, int, const char *);
+    ~LineupPickerWindow();
+    int handle(int);
+
+    void Open(Fl_Lineup_Choice *);
+    void Refresh(); // 阵型列表变了 (还在导入) 时重新筛选
+
+  public:
+    Fl_Input *input_filter;
+    LineupTable *table_lineup;
+    Fl_Lineup_Choice *target = nullptr;
+
+  protected:
+    static void cb_filter(Fl_Widget *, void *);
+    inline void cb_filter();
+    static void cb_table(Fl_Widget *, void *);
+    inline void cb_table();
+
+    void select(int);  // 选中一行并滚动到能看见
+    void choose(bool); // 把选中的行交给下拉框, 参数为是否关闭窗口
+
+    int current = -1; // 选中的行
+};
+
 class Window : public Fl_Double_Window
 {
   public:
@@ -178,9 +279,19 @@ class Window : public Fl_Double_Window
     Fl_Button *button_reset;
     Fl_Choice_ *choice_scene;
     std::vector<Lineup> lineups;
-    unsigned int lineup_count[6] = {0};
+    LineupIndex lineup_index;   // 阵型去重和查找
+    LineupSearch lineup_search; // 相似阵型搜索
+    LineupFilter lineup_filter;           // 阵型筛选的位图索引
+    LineupQuery lineup_query;             // 当前的筛选条件
+    std::vector<size_t> lineup_sorted[6]; // 每个场地的所有阵型序号, 按权重排序
+    std::vector<size_t> lineup_order[6];  // 每个场地满足筛选条件的阵型序号, 和下拉框的顺序一致
+    std::vector<std::string> lineup_names; // 每个阵型显示的名称, 同一场地里不重复
+    std::unordered_set<std::string> lineup_names_used[6];
+    std::unordered_map<std::string, size_t> lineup_names_spaces[6]; // 每个名字下次从补几个空格开始试
     Fl_Button *button_load_lineup;
-    Fl_Choice_ *choice_lineup_name[6];
+    Fl_Lineup_Choice *choice_lineup_name[6];
+    LineupPickerWindow *window_lineup_picker;
+    Fl_Input *input_lineup_filter;
     Fl_Text_Buffer *buffer_lineup_string;
     Fl_Text_Editor *editor_lineup_string;
     Fl_Button *button_get_lineup;
@@ -223,6 +334,7 @@ class Window : public Fl_Double_Window
     Fl_Check_Button *check_tooltips;
     Fl_Button *button_document;
     Fl_Button *button_about;
+    Fl_Menu_Button *button_others_extra;
 
     Fl_Box *box_mask_resource;
     Fl_Box *box_mask_battle;
@@ -247,7 +359,7 @@ class Window : public Fl_Double_Window
     static void cb_find_result_tooltip(Fl_Widget *, void *);
     inline void cb_find_result_tooltip();
 
-    inline void keep_selected_feature();
+    void keep_selected_feature();
 
     static void cb_mode(Fl_Widget *, void *);
     inline void cb_mode();
@@ -256,7 +368,23 @@ class Window : public Fl_Double_Window
     inline void cb_load_lineup();
 
     inline void import_lineup_list(bool);
-    inline void import_lineup_list_file(std::wstring);
+    void lineup_loader_thread(std::vector<std::wstring>);
+    void post_lineup_batch(LINEUP_BATCH &&);
+    void insert_lineup_choice(size_t);
+    std::string unique_lineup_name(uint32_t, const std::string &);
+    void show_lineup_errors(const std::wstring &, const std::vector<std::tuple<int, std::string>> &);
+
+    static void cb_lineup_batch(void *);
+    inline void cb_lineup_batch();
+
+    std::thread lineup_loader;                // 后台导入线程
+    std::atomic<bool> lineup_loading = false; // 正在导入
+    std::atomic<bool> lineup_loader_stop = false;
+    std::mutex lineup_batch_mutex;
+    std::deque<LINEUP_BATCH> lineup_batches; // 等待界面线程处理的批次
+
+    static void cb_filter_lineup(Fl_Widget *, void *);
+    inline void cb_filter_lineup();
 
     static void cb_switch_lineup_scene(Fl_Widget *, void *);
     inline void cb_switch_lineup_scene();
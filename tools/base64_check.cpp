@@ -0,0 +1,156 @@
+// Base64 编解码的检查程序
+// 阵型列表里的每个代码解码之后再编码必须和原来的代码逐字节相同, 解码结果和一个简单的参考实现相同
+// 另外用随机数据检查各种长度和 key 的编码, 解码, 以及非法输入
+// 用法: base64_check [阵型列表文件], 默认为 ../bin/lineup.yml, 有错误时返回非零
+
+#include <fstream>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "base64.h"
+#include "lineup.h"
+
+using namespace Pt;
+
+static const char *ref_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 参考实现, 逐个字节处理, 和 CryptBinaryToStringA (CRYPT_STRING_BASE64 | CRYPT_STRING_NOCRLF) 的输出格式相同
+static std::string ref_encode(const std::vector<uint8_t> &data, uint8_t key)
+{
+    std::string result;
+    for (size_t i = 0; i < data.size(); i += 3)
+    {
+        uint32_t v = 0;
+        size_t n = std::min<size_t>(3, data.size() - i);
+        for (size_t j = 0; j < 3; j++)
+            v = (v << 8) | (j < n ? (uint8_t)(data[i + j] ^ key) : 0);
+        result += ref_chars[(v >> 18) & 0x3f];
+        result += ref_chars[(v >> 12) & 0x3f];
+        result += n > 1 ? ref_chars[(v >> 6) & 0x3f] : '=';
+        result += n > 2 ? ref_chars[v & 0x3f] : '=';
+    }
+    return result;
+}
+
+static bool ref_decode(const std::string &str, std::vector<uint8_t> &data, uint8_t key)
+{
+    data.clear();
+    if (str.size() % 4 != 0)
+        return false;
+    for (size_t i = 0; i < str.size(); i += 4)
+    {
+        uint32_t v = 0;
+        int padding = 0;
+        for (size_t j = 0; j < 4; j++)
+        {
+            char c = str[i + j];
+            const char *p = c == '\0' ? nullptr : strchr(ref_chars, c);
+            bool last = i + 4 == str.size();
+            if (c == '=' && last && j >= 2 && (j == 3 || str[i + 3] == '='))
+            {
+                padding++;
+                v <<= 6;
+                continue;
+            }
+            if (p == nullptr || padding > 0)
+                return false;
+            v = (v << 6) | (uint32_t)(p - ref_chars);
+        }
+        for (int j = 0; j < 3 - padding; j++)
+            data.push_back((uint8_t)((v >> (16 - 8 * j)) & 0xff) ^ key);
+    }
+    return true;
+}
+
+static size_t failures = 0;
+
+static void fail(const char *what, const std::string &str)
+{
+    failures++;
+    if (failures <= 20)
+        printf("FAIL %s: %s\n", what, str.c_str());
+}
+
+// 解码, 和参考实现比较, canonical 为 true 时再编码回去必须和原来相同
+// 填充前多余的位不为零的代码两边都接受, 但是编码回去不会相同, 所以改动过的输入只比较解码
+static void check_round_trip(const std::string &code, uint8_t key, bool canonical = true)
+{
+    std::vector<uint8_t> expected;
+    bool ref_ok = ref_decode(code, expected, key);
+
+    std::vector<uint8_t> buffer(code.size() + 3);
+    size_t size = buffer.size();
+    bool ok = Base64Decode(code, buffer.data(), size, key);
+    if (ok != ref_ok)
+    {
+        fail("decode accepted", code);
+        return;
+    }
+    if (!ok)
+        return;
+    buffer.resize(size);
+    if (buffer != expected)
+        fail("decode bytes", code);
+    if (canonical && Base64Encode(buffer.data(), buffer.size(), key) != code)
+        fail("re-encode", code);
+}
+
+int main(int argc, char **argv)
+{
+    const char *file = argc > 1 ? argv[1] : "../bin/lineup.yml";
+
+    // 阵型列表里的代码
+    std::ifstream ifs(file);
+    std::string str;
+    size_t codes = 0;
+    while (std::getline(ifs, str))
+    {
+        std::string name, code;
+        if (str.empty() || str[0] == '#' || !Lineup::ParseListLine(str, name, code))
+            continue;
+        codes++;
+        check_round_trip(code, 0x54);
+        if (!Lineup(name, code).OK())
+            fail("lineup decode", code);
+    }
+    if (codes == 0)
+    {
+        printf("no lineup codes in %s\n", file);
+        return 1;
+    }
+
+    // 随机数据, 长度覆盖 SIMD 块的边界
+    std::mt19937 gen(1);
+    size_t randoms = 0;
+    for (size_t len = 0; len <= 300; len++)
+    {
+        for (int n = 0; n < 20; n++)
+        {
+            std::vector<uint8_t> data(len);
+            for (auto &b : data)
+                b = (uint8_t)gen();
+            uint8_t key = (n % 2) ? 0x54 : (uint8_t)gen();
+            std::string encoded = Base64Encode(data.data(), data.size(), key);
+            if (encoded != ref_encode(data, key))
+                fail("encode", encoded);
+            check_round_trip(encoded, key);
+
+            // 改掉一个字符, 解码是否接受要和参考实现一致
+            if (!encoded.empty())
+            {
+                std::string broken = encoded;
+                const char *junk = "=*- \n\xff";
+                broken[gen() % broken.size()] = (gen() % 2) ? junk[gen() % 6] : ref_chars[gen() % 64];
+                check_round_trip(broken, key, false);
+                check_round_trip(broken.substr(1), key, false);
+            }
+            randoms++;
+        }
+    }
+
+    printf("%zu lineup codes, %zu random buffers, %zu failures\n", codes, randoms, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+// 阵型列表加载的基准测试
+// 比较原来的正则表达式和现在的单次扫描加载同一个阵型列表文件的耗时, 同时检查两者接受的行和代码完全相同
+// 用法: lineup_bench [阵型列表文件] [次数], 默认为 ../bin/lineup.yml 和 20 次
+
+#include <regex>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+
+#include "lineup.h"
+
+using namespace Pt;
+
+// 原来的写法: 每读一行编译一次列表行的正则, 每构造一个阵型再编译两个
+static bool legacy_parse_line(const std::string &str, std::string &name, std::string &code)
+{
+    std::regex regex_line("\".*\": [a-zA-Z0-9+/=]{1,}");
+    if (!std::regex_match(str, regex_line))
+        return false;
+    size_t p = str.find_last_of(": ");
+    name = str.substr(0 + 1, p - 3);
+    code = str.substr(p + 1);
+    return true;
+}
+
+static bool legacy_is_string(const std::string &str)
+{
+    std::regex regex_string("[0-5](,[a-fA-F0-9]{1,2} [1-6] [1-9] [0-2] [0-4]( [a-zA-Z0-9]{1,}){0,}){0,}");
+    return std::regex_match(str, regex_string);
+}
+
+static bool legacy_is_code(const std::string &str)
+{
+    std::regex regex_code("[a-zA-Z0-9+/=]{18,164}");
+    return std::regex_match(str, regex_code)       //
+           && str.size() % 4 == 0                  //
+           && std::count(str.begin(), str.end(), '=') <= 2;
+}
+
+static std::vector<std::string> read_lines(const char *file)
+{
+    std::vector<std::string> lines;
+    std::ifstream ifs(file);
+    std::string str;
+    while (std::getline(ifs, str))
+        lines.push_back(str);
+    return lines;
+}
+
+// 逐行解析再构造阵型, 和原来导入阵型列表文件时的流程相同
+template <bool Legacy>
+static size_t load(const std::vector<std::string> &lines)
+{
+    std::vector<Lineup> lineups;
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        const std::string &str = lines[i];
+        if (i == 0)
+        {
+            if (str != "#! pvztoolkit")
+                break;
+            continue;
+        }
+        if (str.empty() || str[0] == '#')
+            continue;
+
+        std::string name, code;
+        bool matched = Legacy ? legacy_parse_line(str, name, code) : Lineup::ParseListLine(str, name, code);
+        if (!matched)
+            continue;
+        if (Legacy) // 原来的 Lineup::Init 先后匹配两个正则, 解码部分两者相同
+            if (!legacy_is_string(code))
+                legacy_is_code(code);
+        Lineup lineup(name, code);
+        if (lineup.OK())
+            lineups.push_back(lineup);
+    }
+    return lineups.size();
+}
+
+// 检查新旧两种写法对同一个字符串的判断是否一致, 返回不一致的数量
+static size_t compare(const std::string &str)
+{
+    size_t mismatch = 0;
+    std::string name1, code1, name2, code2;
+    bool line1 = legacy_parse_line(str, name1, code1);
+    bool line2 = Lineup::ParseListLine(str, name2, code2);
+    if (line1 != line2 || (line1 && (name1 != name2 || code1 != code2)))
+        mismatch++;
+    if (legacy_is_string(str) != Lineup::IsLineupString(str))
+        mismatch++;
+    if (legacy_is_code(str) != Lineup::IsLineupCode(str))
+        mismatch++;
+    if (mismatch > 0)
+        printf("mismatch: %s\n", str.c_str());
+    return mismatch;
+}
+
+int main(int argc, char **argv)
+{
+    const char *file = argc > 1 ? argv[1] : "../bin/lineup.yml";
+    int runs = argc > 2 ? atoi(argv[2]) : 20;
+    if (runs <= 0)
+        runs = 1;
+
+    std::vector<std::string> lines = read_lines(file);
+    if (lines.empty())
+    {
+        printf("can not read %s\n", file);
+        return 1;
+    }
+
+    // 接受规则: 文件里的每一行, 每一行的代码部分, 以及随机改动过的行
+    size_t mismatch = 0;
+    size_t checked = 0;
+    std::mt19937 gen(1);
+    const std::string alphabet = "\": ,=+/0123456789abcdefABCDEFxyzXYZ\r";
+    for (const auto &str : lines)
+    {
+        mismatch += compare(str);
+        size_t p = str.find_last_of(' ');
+        if (p != std::string::npos)
+            mismatch += compare(str.substr(p + 1));
+        checked += 2;
+
+        for (int i = 0; i < 20 && !str.empty(); i++)
+        {
+            std::string s = str;
+            size_t pos = gen() % s.size();
+            switch (gen() % 3)
+            {
+            case 0:
+                s[pos] = alphabet[gen() % alphabet.size()];
+                break;
+            case 1:
+                s.erase(pos, 1 + gen() % 4);
+                break;
+            default:
+                s.insert(pos, 1, alphabet[gen() % alphabet.size()]);
+                break;
+            }
+            mismatch += compare(s);
+            if (p != std::string::npos && p + 1 < s.size())
+                mismatch += compare(s.substr(p + 1));
+            checked += 2;
+        }
+    }
+    for (int i = 0; i < 20000; i++) // 阵型字符串格式
+    {
+        std::string s = std::to_string(gen() % 7);
+        int n = gen() % 4;
+        for (int j = 0; j < n; j++)
+        {
+            char item[64];
+            snprintf(item, sizeof(item), ",%x %d %d %d %d", (unsigned)(gen() % 300), (int)(gen() % 8), (int)(gen() % 11),
+                     (int)(gen() % 4), (int)(gen() % 6));
+            s += item;
+            if (gen() % 2)
+                s += " a1";
+        }
+        if (gen() % 4 == 0 && !s.empty())
+            s[gen() % s.size()] = alphabet[gen() % alphabet.size()];
+        mismatch += compare(s);
+        checked++;
+    }
+    printf("acceptance: %zu strings checked, %zu mismatches\n", checked, mismatch);
+
+    size_t count_legacy = 0, count_scanner = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++)
+        count_legacy = load<true>(lines);
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++)
+        count_scanner = load<false>(lines);
+    auto t2 = std::chrono::steady_clock::now();
+
+    double ms_legacy = std::chrono::duration<double, std::milli>(t1 - t0).count() / runs;
+    double ms_scanner = std::chrono::duration<double, std::milli>(t2 - t1).count() / runs;
+    printf("regex:   %zu lineups, %.2f ms/load\n", count_legacy, ms_legacy);
+    printf("scanner: %zu lineups, %.2f ms/load\n", count_scanner, ms_scanner);
+
+    return (mismatch == 0 && count_legacy == count_scanner) ? 0 : 1;
+}
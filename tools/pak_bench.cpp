@@ -0,0 +1,210 @@
+// pak 解包的吞吐量基准测试
+// 生成一个几百 MB 的 pak, 分别用原来的做法 (整个文件读进内存异或, 每个文件再复制一份写出) 和现在的 PAK::Unpack 解包
+// 原来的做法用标准库重写, 和原来的 Win32 实现的内存访问方式相同, 两者的解包结果逐个文件比较
+// 文件在系统缓存里, 测的是热缓存下的吞吐量
+// 用法: pak_bench [大小 MB] [临时文件夹] [线程数], 默认为 400, pak_bench_tmp, 0 (CPU 核心数)
+
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "pak.h"
+
+using namespace Pt;
+namespace fs = std::filesystem;
+
+// 生成 pak, 文件大小按游戏资源的比例混合: 大部分是几 KB 到几十 KB 的小文件, 少数几 MB 的大文件
+static bool make_pak(const fs::path &file, uint64_t total_size, std::vector<PAK_ENTRY> &entries)
+{
+    std::mt19937 gen(1);
+    entries.clear();
+    uint64_t sum = 0;
+    for (size_t i = 0; sum < total_size; i++)
+    {
+        uint32_t size = (gen() % 20 == 0) ? 1024 * 1024 + gen() % (8 * 1024 * 1024) : 1024 + gen() % (64 * 1024);
+        size = (uint32_t)std::min<uint64_t>(size, total_size - sum);
+        char name[64];
+        snprintf(name, sizeof(name), "data\\dir%02u\\file%05zu.bin", (unsigned)(i % 37), i);
+        entries.push_back({name, 0, size, 132000000000000000ULL});
+        sum += size;
+    }
+
+    std::ofstream ofs(file, std::ios::binary);
+    std::vector<uint8_t> buffer;
+    auto put = [&](const void *data, size_t n)
+    {
+        const uint8_t *p = (const uint8_t *)data;
+        for (size_t i = 0; i < n; i++)
+            buffer.push_back(p[i] ^ 0xf7);
+    };
+
+    uint32_t magic = 0xBAC04AC0, version = 0;
+    put(&magic, 4);
+    put(&version, 4);
+    for (const auto &e : entries)
+    {
+        uint8_t eof_flag = 0x00, name_width = (uint8_t)e.name.size();
+        put(&eof_flag, 1);
+        put(&name_width, 1);
+        put(e.name.data(), e.name.size());
+        put(&e.size, 4);
+        put(&e.time, 8);
+    }
+    uint8_t eof_flag = 0x80;
+    put(&eof_flag, 1);
+    ofs.write((const char *)buffer.data(), buffer.size());
+
+    // 文件内容是序号和位置的简单组合, 压缩不了也容易核对
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        data.resize(entries[i].size);
+        uint32_t x = (uint32_t)i * 2654435761u;
+        for (auto &b : data)
+        {
+            x = x * 1103515245u + 12345u;
+            b = (uint8_t)((x >> 16) ^ 0xf7);
+        }
+        ofs.write((const char *)data.data(), data.size());
+    }
+    return ofs.good();
+}
+
+// 原来的解包流程
+static bool legacy_unpack(const fs::path &src_file, const fs::path &dst_dir)
+{
+    std::ifstream ifs(src_file, std::ios::binary);
+    size_t size = (size_t)fs::file_size(src_file);
+
+    // 将整个文件内容加载到内存里, 整个文件与 0xF7 异或
+    char *buffer = new char[size];
+    ifs.read(buffer, size);
+    for (size_t i = 0; i < size; ++i)
+        buffer[i] = buffer[i] ^ 0xf7;
+
+    size_t offset = 8;
+    std::vector<std::string> files_name;
+    std::vector<uint32_t> files_size;
+    while (buffer[offset++] == 0x00)
+    {
+        uint8_t name_width = (uint8_t)buffer[offset++];
+        files_name.push_back(std::string(buffer + offset, name_width));
+        offset += name_width;
+        uint32_t file_size;
+        memcpy(&file_size, buffer + offset, 4);
+        files_size.push_back(file_size);
+        offset += 4 + 8;
+    }
+
+    // 每个文件再复制一份写出
+    for (size_t i = 0; i < files_name.size(); i++)
+    {
+        std::string name = files_name[i];
+        for (auto &c : name)
+            if (c == '\\')
+                c = '/';
+        fs::path output_path = dst_dir / name;
+        fs::create_directories(output_path.parent_path());
+
+        char *file_buffer = new char[files_size[i]];
+        for (size_t j = 0; j < files_size[i]; j++)
+            file_buffer[j] = buffer[offset + j];
+        offset += files_size[i];
+
+        std::ofstream ofs(output_path, std::ios::binary);
+        ofs.write(file_buffer, files_size[i]);
+        delete[] file_buffer;
+        if (!ofs.good())
+        {
+            delete[] buffer;
+            return false;
+        }
+    }
+
+    delete[] buffer;
+    return true;
+}
+
+static bool same_file(const fs::path &a, const fs::path &b)
+{
+    std::ifstream fa(a, std::ios::binary), fb(b, std::ios::binary);
+    std::vector<char> ba(1 << 20), bb(1 << 20);
+    while (fa && fb)
+    {
+        fa.read(ba.data(), ba.size());
+        fb.read(bb.data(), bb.size());
+        if (fa.gcount() != fb.gcount() || memcmp(ba.data(), bb.data(), (size_t)fa.gcount()) != 0)
+            return false;
+    }
+    return !fa && !fb;
+}
+
+template <typename F>
+static double measure(F &&func)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    func();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t size_mb = argc > 1 ? strtoull(argv[1], nullptr, 10) : 400;
+    fs::path dir = argc > 2 ? argv[2] : "pak_bench_tmp";
+    unsigned int threads = argc > 3 ? (unsigned int)atoi(argv[3]) : 0;
+    if (size_mb == 0)
+        size_mb = 1;
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir);
+    fs::path pak_file = dir / "bench.pak";
+
+    std::vector<PAK_ENTRY> entries;
+    if (!make_pak(pak_file, size_mb * 1024 * 1024, entries))
+    {
+        printf("can not write %s\n", pak_file.string().c_str());
+        return 1;
+    }
+    double mb = (double)fs::file_size(pak_file) / (1024 * 1024);
+    printf("pak: %.1f MB, %zu files\n", mb, entries.size());
+
+    // 先读一遍, 让几种做法都在热缓存下比较
+    legacy_unpack(pak_file, dir / "warm");
+    fs::remove_all(dir / "warm", ec);
+
+    bool ok = true;
+    double t_legacy = measure([&]() { ok = legacy_unpack(pak_file, dir / "legacy") && ok; });
+
+    PAK pak;
+    int ret_single = UNPACK_SUCCESS, ret_multi = UNPACK_SUCCESS;
+    double t_single = measure([&]() { ret_single = pak.Unpack(pak_file, dir / "single", 1); });
+    double t_multi = measure([&]() { ret_multi = pak.Unpack(pak_file, dir / "multi", threads); });
+    ok = ok && ret_single == UNPACK_SUCCESS && ret_multi == UNPACK_SUCCESS;
+
+    printf("legacy (read all, copy per file): %7.3f s, %7.1f MB/s\n", t_legacy, mb / t_legacy);
+    printf("Unpack, threads 1:                %7.3f s, %7.1f MB/s\n", t_single, mb / t_single);
+    printf("Unpack, threads %-2u (0 = auto):    %7.3f s, %7.1f MB/s\n", threads, t_multi, mb / t_multi);
+
+    // 结果逐个文件比较
+    size_t mismatch = 0;
+    for (const auto &e : entries)
+    {
+        std::string name = e.name;
+        for (auto &c : name)
+            if (c == '\\')
+                c = '/';
+        if (!same_file(dir / "legacy" / name, dir / "single" / name) //
+            || !same_file(dir / "legacy" / name, dir / "multi" / name))
+            mismatch++;
+    }
+    printf("%zu files compared, %zu mismatches\n", entries.size(), mismatch);
+
+    fs::remove_all(dir, ec);
+    return (ok && mismatch == 0) ? 0 : 1;
+}